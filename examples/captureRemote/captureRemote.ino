@@ -0,0 +1,33 @@
+#include <lightIRRecv.h>
+
+// This sketch sends the duration of every mark and space that the sensor receives over Serial,
+// so that you can see why a remote's frames aren't being decoded, or save them as traces for
+// extras/hostBench. The data is binary, so the Serial Monitor can't show it. Save it on your
+// computer instead, and turn it into a trace with extras/captureToTrace.py, for instance on Linux:
+//
+//	stty -F /dev/ttyACM0 115200 raw
+//	cat /dev/ttyACM0 > capture.bin
+//	(press some buttons, then Ctrl+C)
+//	extras/captureToTrace.py capture.bin PROTOCOL_NEC > nec.trace
+
+const uint8_t pinIRSensor = 2;
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void loop(void)
+{
+	// sends whatever has been received since the last call, without waiting for the whole frame
+	lirrCapture(Serial);
+}
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void setup(void)
+{
+	// anything slower than 115200 baud may not keep up with the edges
+	Serial.begin(115200);
+
+	lirrBeginCapture(pinIRSensor);
+}
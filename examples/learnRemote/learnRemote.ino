@@ -0,0 +1,150 @@
+#include <lightIRRecv.h>
+
+// This sketch learns the protocol of a remote that none of the protocol constants can decode.
+// Press the same button on your remote a few times (letting go in between). Each frame that is
+// received makes the learned timing a little more accurate. After a few frames, the sketch prints
+// protocol settings that you can paste into your own sketches, and then starts decoding with them,
+// so you can check that all of your buttons work.
+
+// Learning works for pulse distance and pulse width protocols, and for bi-phase protocols without
+// a start burst (like RC5). A frame can't be learned if all of its bits are the same, so if nothing
+// happens, try another button.
+
+// Learning mode measures every mark and space, so it can't be used with lirrExternalInterruptSense
+// set to LIRR_FALLING_EDGE in lightIRRecv.h.
+#ifndef LIRR_LEARNING_SUPPORTED
+#error "learning mode needs both edges of the signal, and a protocol that isn't chosen with lirrStaticProtocol"
+#endif
+
+const uint8_t pinIRSensor = 2;
+const uint8_t framesToLearn = 4;
+
+lirrLearned_t learned;
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void printTime(uint32_t value)
+{
+	// with lirrTimerTicks, the settings hold Timer1 ticks, so they're turned back into the
+	// microseconds that LIRR_US() takes
+#ifdef lirrTimerTicks
+	value = value * 64000UL / (F_CPU / 1000UL);
+#endif
+	Serial.print(F("LIRR_US("));
+	Serial.print(value);
+	Serial.print(F(")"));
+}
+
+void printWindow(const uint16_t window[2])
+{
+	Serial.print(F("{"));
+	printTime(window[0]);
+	Serial.print(F(","));
+	printTime(window[1]);
+	Serial.print(F("}"));
+}
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void printSettings(const lirrPulseFractionSettings_t &settings)
+{
+	Serial.print(F("const lirrPulseFractionSettings_t PROTOCOL_LEARNED = {"));
+	Serial.print(settings.bits);
+	Serial.print(settings.distanceMode ? F(",true,") : F(",false,"));
+	printTime(settings.startMin);
+	Serial.print(F(","));
+	printTime(settings.startMax);
+	Serial.print(F(","));
+	printTime(settings.bitMin);
+	Serial.print(F(","));
+	printTime(settings.bitSep);
+	Serial.print(F(","));
+	printTime(settings.bitMax);
+	Serial.print(F(",0,0,0,"));
+	printTime(settings.glitchTime);
+	Serial.println(F(",0,0};"));
+}
+
+void printSettings(const lirrBiPhaseSettings_t &settings)
+{
+	Serial.print(F("const lirrBiPhaseSettings_t PROTOCOL_LEARNED = {"));
+	Serial.print(settings.bits);
+	Serial.print(settings.aceRising ? F(",true,") : F(",false,"));
+	printWindow(settings.bitTime);
+	Serial.print(F(","));
+	printWindow(settings.startTime);
+	Serial.print(F(","));
+	printWindow(settings.toggleTime);
+	Serial.print(F(","));
+	Serial.print(settings.togglePos);
+	Serial.println(F(",0};"));
+}
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void decodeWithLearnedSettings(void)
+{
+	// the learned settings only exist once learning is over, so they're made the first time
+	// that each of these lines runs (lirrBegin() needs them to stay around)
+	if (learned.encoding == LIRR_LEARN_BI_PHASE)
+	{
+		static const lirrBiPhaseSettings_t settings = lirrLearnedBiPhase(learned);
+		printSettings(settings);
+		lirrBegin(pinIRSensor, settings);
+	}
+	else
+	{
+		static const lirrPulseFractionSettings_t settings = lirrLearnedPulseFraction(learned);
+		printSettings(settings);
+		lirrBegin(pinIRSensor, settings);
+	}
+	Serial.println(F("Now decoding with these settings. Press some buttons."));
+}
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void loop(void)
+{
+	static bool learning = true;
+
+	if (learning)
+	{
+		if (lirrLearn(learned))
+		{
+			Serial.print(F("Learned frame "));
+			Serial.print(learned.frames);
+			Serial.print(F(": "));
+			Serial.println(learned.code, HEX);
+			if (learned.frames == framesToLearn)
+			{
+				learning = false;
+				decodeWithLearnedSettings();
+			}
+		}
+		return;
+	}
+
+	remoteEvents_t remoteEvents = lirrGetEvents();
+	if (remoteEvents.buttonState == BUTTON_PRESSED)
+	{
+		Serial.print(F("Pressed: "));
+		Serial.println(remoteEvents.buttonCode, HEX);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void setup(void)
+{
+	Serial.begin(9600);
+	while (!Serial) {;}
+
+	Serial.println(F("Press the same button on your remote a few times."));
+
+	lirrBeginLearning(pinIRSensor, learned);
+}
@@ -5,108 +5,93 @@
 // Once known, then you can use the protocol name as a named constant when
 // calling lirrBegin() in other sketches designed for that specific remote.
 
+// All of the protocols are decoded at the same time, so a single button press
+// is enough to identify the protocol. Sharp frames have no start burst, so under
+// fluorescent or LED lighting an RC5 or RC6 frame that's cut short can now and
+// then be reported as PROTOCOL_SHARP; press the button again to make sure.
+
 const uint8_t pinIRSensor = 2;
-const uint8_t PROTOCOL_COUNT = 8;
-const uint32_t TEST_TIME = 2000000UL;
+
+const lirrPulseFractionSettings_t *const pfProtocols[] = {
+	&PROTOCOL_NEC,
+	&PROTOCOL_JVC,
+	&PROTOCOL_RCA,
+	&PROTOCOL_SHARP,
+	&PROTOCOL_SAMSUNG,
+	&PROTOCOL_SIRC
+};
+const lirrBiPhaseSettings_t *const bpProtocols[] = {
+	&PROTOCOL_RC5,
+	&PROTOCOL_RC6_MODE0
+};
+const uint8_t PF_COUNT = sizeof(pfProtocols) / sizeof(pfProtocols[0]);
+const uint8_t BP_COUNT = sizeof(bpProtocols) / sizeof(bpProtocols[0]);
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void printProtocol(uint8_t protocol)
+{
+	// protocols are numbered in the order they are listed above, pulse fraction protocols first
+	switch (protocol)
+	{
+		case 0:
+			Serial.print(F("PROTOCOL_NEC"));
+			break;
+		case 1:
+			Serial.print(F("PROTOCOL_JVC"));
+			break;
+		case 2:
+			Serial.print(F("PROTOCOL_RCA"));
+			break;
+		case 3:
+			Serial.print(F("PROTOCOL_SHARP"));
+			break;
+		case 4:
+			Serial.print(F("PROTOCOL_SAMSUNG"));
+			break;
+		case 5:
+			Serial.print(F("PROTOCOL_SIRC"));
+			break;
+		case 6:
+			Serial.print(F("PROTOCOL_RC5"));
+			break;
+		case 7:
+			Serial.print(F("PROTOCOL_RC6_MODE0"));
+			break;
+	}
+}
 
 // ----------------------------------------------------------------------------------------------------
 // ----------------------------------------------------------------------------------------------------
 
 void loop(void)
 {
-	static bool identified = false;
 	static bool showHeld = true;
-	
-	if (!identified)
+
+	remoteEvents_t remoteEvents = lirrGetEvents();
+	switch(remoteEvents.buttonState)
 	{
-		uint32_t lastSwitch;
-		for (uint8_t i = PROTOCOL_COUNT; i > 0; i--)
-		{
-			String protocolName;
-			switch (i)
-			{
-				case 8:
-					protocolName = "PROTOCOL_NEC";
-					lirrBegin(pinIRSensor, PROTOCOL_NEC);
-					break;
-				case 7:
-					protocolName = "PROTOCOL_RC6_MODE0";
-					lirrBegin(pinIRSensor, PROTOCOL_RC6_MODE0);
-					break;
-				case 6:
-					protocolName = "PROTOCOL_RC5";
-					lirrBegin(pinIRSensor, PROTOCOL_RC5);
-					break;
-				case 5:
-					protocolName = "PROTOCOL_SIRC";
-					lirrBegin(pinIRSensor, PROTOCOL_SIRC);
-					break;
-				case 4:
-					protocolName = "PROTOCOL_SAMSUNG";
-					lirrBegin(pinIRSensor, PROTOCOL_SAMSUNG);
-					break;
-				case 3:
-					protocolName = "PROTOCOL_RCA";
-					lirrBegin(pinIRSensor, PROTOCOL_RCA);
-					break;
-				case 2:
-					protocolName = "PROTOCOL_JVC";
-					lirrBegin(pinIRSensor, PROTOCOL_JVC);
-					break;
-				case 1:
-					protocolName = "PROTOCOL_SHARP";
-					lirrBegin(pinIRSensor, PROTOCOL_SHARP);
-					break;		
-			}
-			
-			Serial.print(F("\nTrying "));
-			Serial.print(protocolName);
-			Serial.println(F("..."));
-			Serial.flush();
-			
-			lastSwitch = micros();
-			while (((uint32_t)micros() - lastSwitch) < TEST_TIME)
+		case (BUTTON_PRESSED):
+			Serial.print(F("\nPressed: "));
+			Serial.print(remoteEvents.buttonCode);
+			Serial.print(F(" ("));
+			printProtocol(lirrGetProtocol());
+			Serial.println(F(")"));
+			break;
+		case (BUTTON_HELD):
+			if (showHeld)
 			{
-				remoteEvents_t remoteEvents = lirrGetEvents();
-				if (remoteEvents.buttonState == BUTTON_PRESSED)
-				{
-					identified = true;
-					Serial.println(F("Match found!"));
-					Serial.print(F("\nPressed: "));
-					Serial.println(remoteEvents.buttonCode);
-					Serial.flush();
-					break;
-				}
-			}
-			if (identified) break;
-		}
-	}
-	else
-	{
-		remoteEvents_t remoteEvents = lirrGetEvents();
-		switch(remoteEvents.buttonState)
-		{
-			case (BUTTON_PRESSED):
-				Serial.print(F("\nPressed: "));
-				Serial.println(remoteEvents.buttonCode);
-				Serial.flush();
-				break;
-			case (BUTTON_HELD):
-				if (showHeld)
-				{
-					Serial.print(F("Held: "));
-					Serial.println(remoteEvents.buttonCode);
-					Serial.flush();
-					showHeld = false;
-				}
-				break;
-			case (BUTTON_RELEASED):
-				Serial.print(F("Released: "));
+				Serial.print(F("Held: "));
 				Serial.println(remoteEvents.buttonCode);
-				Serial.flush();
-				showHeld = true;
-				break;
-		}
+				showHeld = false;
+			}
+			break;
+		case (BUTTON_RELEASED):
+			Serial.print(F("Released: "));
+			Serial.println(remoteEvents.buttonCode);
+			showHeld = true;
+			break;
 	}
 }
 
@@ -118,6 +103,7 @@ void setup(void)
 	Serial.begin(9600);
 	while (!Serial) {;}
 
-	Serial.println(F("Repeatedly press a button on your remote."));
-	Serial.flush();
+	Serial.println(F("Press a button on your remote."));
+
+	lirrBegin(pinIRSensor, pfProtocols, PF_COUNT, bpProtocols, BP_COUNT);
 }
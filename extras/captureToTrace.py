@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Light IR Receiver - capture stream decoder
+
+Turns the binary stream sent by capture mode (lirrBeginCapture() and lirrCapture(), see the
+captureRemote example) back into frames, and writes them in the trace format of extras/hostBench:
+
+	PROTOCOL_NEC - 9000 4500 560 560 ...
+
+Save the stream first, for instance on Linux (with the sketch's baud rate):
+
+	stty -F /dev/ttyACM0 115200 raw
+	cat /dev/ttyACM0 > capture.bin
+
+and then:
+
+	captureToTrace.py capture.bin PROTOCOL_NEC [--code 0x20DF10EF] > nec.trace
+
+The protocol and code are only written to the trace (hostBench checks that the frames decode to
+the code, or only counts them with the default of -). A frame ends at the first space longer
+than --gap microseconds. Frames that lost edges or had packets spoilt are left out, and counted
+on stderr.
+"""
+import argparse
+import sys
+
+SYNC = 0xA5
+LOST_FLAG = 0x80
+MAX_DURATIONS = 24
+LONG_ENTRY = 0xFFFE # a long mark or space (with bit 0 set for a mark), the next entry is its length
+LONG_UNIT = 1024 # microseconds
+
+
+def packets(data):
+	"""Yields (lost, durations) for each packet with a good checksum, and None for each bad one."""
+	i = 0
+	while i < len(data):
+		if data[i] != SYNC:
+			i += 1
+			continue
+		if i + 2 > len(data):
+			break
+		count = data[i + 1] & ~LOST_FLAG
+		end = i + 2 + count * 2 + 1
+		if not 0 < count <= MAX_DURATIONS or end > len(data) or sum(data[i + 1:end]) & 0xFF:
+			# not a packet after all, or a spoilt one, so look for the next sync byte
+			yield None
+			i += 1
+			continue
+		durations = [data[j] | (data[j + 1] << 8) for j in range(i + 2, end - 1, 2)]
+		yield (data[i + 1] & LOST_FLAG) != 0, durations
+		i = end
+
+
+def frames(data, gap):
+	"""Yields (good, durations) for each frame, with the durations starting with a mark."""
+	frame = []
+	good = True
+	longEntry = None
+	for packet in packets(data):
+		if packet is None:
+			good = False
+			longEntry = None
+			continue
+		lost, durations = packet
+		if lost:
+			good = False
+		for entry in durations:
+			if longEntry is not None:
+				# the length of a long mark or space
+				mark = longEntry & 1
+				duration = entry * LONG_UNIT
+				longEntry = None
+			elif entry >= LONG_ENTRY:
+				longEntry = entry
+				continue
+			else:
+				mark = entry & 1
+				duration = entry & 0xFFFE
+			if not frame:
+				# frames start with a mark, and anything before it was lost
+				if mark:
+					frame.append(duration)
+				continue
+			if not mark and duration > gap:
+				yield good, frame
+				frame = []
+				good = True
+				continue
+			if mark != (len(frame) % 2 == 0):
+				good = False # two marks or two spaces in a row
+			frame.append(duration)
+	if frame:
+		yield good, frame
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Writes a hostBench trace from a capture stream.")
+	parser.add_argument("input", help="the binary stream saved from the sketch (- for stdin)")
+	parser.add_argument("protocol", help="the protocol constant to write for each frame (eg, PROTOCOL_NEC)")
+	parser.add_argument("--code", default="-", help="the code that every frame should decode to (default -)")
+	parser.add_argument("--gap", type=int, default=8000, help="the shortest space between frames, in microseconds (default 8000)")
+	args = parser.parse_args()
+
+	if args.input == "-":
+		data = sys.stdin.buffer.read()
+	else:
+		with open(args.input, "rb") as inputFile:
+			data = inputFile.read()
+
+	written = dropped = 0
+	print("# written by captureToTrace.py from %s" % args.input)
+	for good, durations in frames(data, args.gap):
+		if not good:
+			dropped += 1
+			continue
+		print("%s %s %s" % (args.protocol, args.code, " ".join(str(d) for d in durations)))
+		written += 1
+	sys.stderr.write("%d frames written, %d left out\n" % (written, dropped))
+
+
+if __name__ == "__main__":
+	main()
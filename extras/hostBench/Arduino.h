@@ -0,0 +1,98 @@
+/*
+
+Minimal stand-in for the parts of the Arduino core (and AVR registers) used by the Light IR Receiver,
+so that lightIRRecv.cpp can be compiled and benchmarked on a PC. See hostBench.cpp.
+
+*/
+#ifndef hostBenchArduino_H
+#define hostBenchArduino_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define _BV(bit) (1 << (bit))
+
+// ISRs become ordinary functions that the benchmark calls
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+
+// interrupt flag registers are cleared by writing a one to them
+struct hostFlagRegister_t
+{
+	uint8_t value;
+	operator uint8_t() const { return value; }
+	hostFlagRegister_t &operator=(uint8_t bits) { value &= ~bits; return *this; }
+	hostFlagRegister_t &operator|=(uint8_t bits) { value &= ~bits; return *this; }
+};
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t PIND, PINB, PINC;
+extern volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t EICRA, EIMSK;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIMSK0;
+extern volatile uint16_t TCNT1, ICR1;
+extern hostFlagRegister_t PCIFR, EIFR, TIFR1, TIFR0;
+
+// ATmega328P bit numbers
+#define ISC00 0
+#define ISC10 2
+#define INT0 0
+#define INTF0 0
+#define CS10 0
+#define CS11 1
+#define ICES1 6
+#define ICNC1 7
+#define TOIE1 0
+#define ICIE1 5
+#define TOV1 0
+#define ICF1 5
+#define OCIE0B 2
+#define OCF0B 2
+
+// the PC has a single address space, so flash is read like RAM
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define memcpy_P memcpy
+
+// the part of the Print class used by lirrCapture()
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t value) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size)
+	{
+		size_t written = 0;
+		while (size--)
+			written += write(*buffer++);
+		return written;
+	}
+};
+
+static inline void cli(void) {}
+static inline void sei(void) {}
+
+uint32_t micros(void);
+unsigned long millis(void);
+void pinMode(uint8_t pin, uint8_t mode);
+
+// Uno pin mapping: D0...D7 are PORTD (PCINT2), D8...D13 are PORTB (PCINT0), A0...A5 are PORTC (PCINT1)
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p) (((p) <= 7) ? &PCMSK2 : (((p) <= 13) ? &PCMSK0 : &PCMSK1))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+#define digitalPinToBitMask(p) ((uint8_t)_BV(digitalPinToPCMSKbit(p)))
+#define digitalPinToPort(p) digitalPinToPCICRbit(p)
+#define portInputRegister(port) (((port) == 2) ? &PIND : (((port) == 0) ? &PINB : &PINC))
+
+#endif
@@ -0,0 +1,14 @@
+// Stand-in for avr/sleep.h (see ../Arduino.h)
+#ifndef hostBenchSleep_H
+#define hostBenchSleep_H
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_PWR_DOWN 2
+#define SLEEP_MODE_STANDBY 6
+
+#define set_sleep_mode(mode) ((void)(mode))
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()
+
+#endif
@@ -0,0 +1,7 @@
+#!/bin/sh
+# Builds the host benchmark. Any arguments are passed to the compiler, for example:
+#	./build.sh -DlirrQueueSize=4 -DlirrEdgeBufferSize=128
+# and then run it with:
+#	./hostBench [-n framesPerProtocol] [-g glitchesPerFrame] [traceFile...]
+cd "$(dirname "$0")" || exit 1
+${CXX:-g++} -O2 -Wall -Wextra -Wno-implicit-fallthrough -I. -I../../src "$@" -o hostBench hostBench.cpp hostArduino.cpp ../../src/lightIRRecv.cpp
@@ -0,0 +1,27 @@
+// State behind the stand-in Arduino core in Arduino.h
+#include "Arduino.h"
+#include "hostArduino.h"
+
+volatile uint8_t SREG;
+volatile uint8_t PIND = 0xFF, PINB = 0xFF, PINC = 0xFF;
+volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t EICRA, EIMSK;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIMSK0;
+volatile uint16_t TCNT1, ICR1;
+hostFlagRegister_t PCIFR, EIFR, TIFR1, TIFR0;
+
+uint32_t hostTime = 0;
+
+uint32_t micros(void)
+{
+	return hostTime;
+}
+
+unsigned long millis(void)
+{
+	return hostTime / 1000;
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
@@ -0,0 +1,10 @@
+// Controls for the stand-in Arduino core
+#ifndef hostArduino_H
+#define hostArduino_H
+
+#include <stdint.h>
+
+// the value returned by micros()
+extern uint32_t hostTime;
+
+#endif
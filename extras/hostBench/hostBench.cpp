@@ -0,0 +1,873 @@
+/*
+
+Light IR Receiver - host benchmark
+
+Compiles the library natively (against the stand-in Arduino core in Arduino.h), replays edge timing
+traces through its interrupt service routine, and reports decode throughput and correctness for each
+protocol constant. Build it with build.sh; any -D options given to build.sh are passed to the compiler,
+so the compile time settings in lightIRRecv.h can be benchmarked without editing the header.
+
+Usage: hostBench [-n framesPerProtocol] [-g glitchesPerFrame] [traceFile...]
+
+Without trace files, synthetic frames with random codes are generated from the settings of each
+protocol constant. A trace file holds one frame per line:
+
+	PROTOCOL_NEC 0x20DF10EF 9000 4500 560 560 560 1690 ...
+
+That is the protocol, the expected code (or - if it isn't known) and then the durations of the frame in
+microseconds, alternating between mark (IR detected) and space. Lines starting with # are ignored.
+
+With -g, each frame gets that many short marks (like those caused by fluorescent and LED lighting)
+inserted into randomly chosen spaces before it is replayed.
+
+The exit status is non-zero if any frame with a known code didn't decode to that code when its protocol
+was the only one selected, if a protocol that could be learned didn't decode all of its frames with the
+learned settings, or if lirrGetGesture() didn't turn a button being held into the expected gestures.
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "hostArduino.h"
+#include "lightIRRecv.h"
+
+// ----------------------------------------------------------------------------------------------------
+// The interrupt service routine that the edges are fed to
+// ----------------------------------------------------------------------------------------------------
+
+#if defined(lirrInputCapture)
+extern "C" void TIMER1_CAPT_vect(void);
+#ifndef lirrTimerTicks
+extern "C" void TIMER1_OVF_vect(void);
+#endif
+#elif defined(lirrExternalInterrupt)
+#if lirrExternalInterrupt == 0
+extern "C" void INT0_vect(void);
+#define benchVector INT0_vect
+#else
+extern "C" void INT1_vect(void);
+#define benchVector INT1_vect
+#endif
+#elif !defined(lirrExternalFeed)
+extern "C" void lirrPinChangeVector(void);
+#define benchVector lirrPinChangeVector
+#endif
+#ifdef lirrGateTime
+extern "C" void TIMER0_COMPB_vect(void);
+#endif
+
+const uint8_t benchPin = 2;
+
+struct frame_t
+{
+	std::string protocol;
+	bool codeKnown;
+	uint32_t code;
+	std::vector<uint32_t> durations; // alternating mark and space, starting with a mark
+};
+
+struct protocol_t
+{
+	const char *name;
+	const lirrPulseFractionSettings_t *pPF;
+	const lirrBiPhaseSettings_t *pBP;
+	bool multi; // also decoded with all of the other protocols at once
+	uint8_t index; // in the protocol table (LIRR_INDEX_)
+};
+
+// the _STD protocols decode the same frames as the ones without, and the start of a SIRC15 or SIRC20
+// frame is a SIRC frame, so they're only decoded on their own
+const protocol_t protocols[] = {
+	{"PROTOCOL_NEC", &PROTOCOL_NEC, NULL, true, LIRR_INDEX_NEC},
+	{"PROTOCOL_JVC", &PROTOCOL_JVC, NULL, true, LIRR_INDEX_JVC},
+	{"PROTOCOL_RCA", &PROTOCOL_RCA, NULL, true, LIRR_INDEX_RCA},
+	{"PROTOCOL_SHARP", &PROTOCOL_SHARP, NULL, true, LIRR_INDEX_SHARP},
+	{"PROTOCOL_SAMSUNG", &PROTOCOL_SAMSUNG, NULL, true, LIRR_INDEX_SAMSUNG},
+	{"PROTOCOL_SIRC", &PROTOCOL_SIRC, NULL, true, LIRR_INDEX_SIRC},
+	{"PROTOCOL_RC5", NULL, &PROTOCOL_RC5, true, LIRR_INDEX_RC5},
+	{"PROTOCOL_RC6_MODE0", NULL, &PROTOCOL_RC6_MODE0, true, LIRR_INDEX_RC6_MODE0},
+	{"PROTOCOL_NEC_STD", &PROTOCOL_NEC_STD, NULL, false, LIRR_INDEX_NEC_STD},
+	{"PROTOCOL_JVC_STD", &PROTOCOL_JVC_STD, NULL, false, LIRR_INDEX_JVC_STD},
+	{"PROTOCOL_SAMSUNG_STD", &PROTOCOL_SAMSUNG_STD, NULL, false, LIRR_INDEX_SAMSUNG_STD},
+	{"PROTOCOL_SIRC_STD", &PROTOCOL_SIRC_STD, NULL, false, LIRR_INDEX_SIRC_STD},
+	{"PROTOCOL_SIRC15", &PROTOCOL_SIRC15, NULL, false, LIRR_INDEX_SIRC15},
+	{"PROTOCOL_SIRC20", &PROTOCOL_SIRC20, NULL, false, LIRR_INDEX_SIRC20},
+#ifdef lirrWideCodes
+	{"PROTOCOL_KASEIKYO", &PROTOCOL_KASEIKYO, NULL, false, LIRR_INDEX_KASEIKYO}
+#endif
+};
+const uint8_t protocolCount = sizeof(protocols) / sizeof(protocols[0]);
+
+static const protocol_t *findProtocol(const std::string &name)
+{
+	for (uint8_t i = 0; i < protocolCount; i++)
+		if (name == protocols[i].name)
+			return &protocols[i];
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Synthetic frames
+// Timings are taken from the middle of each of the protocol's acceptance windows
+// ----------------------------------------------------------------------------------------------------
+
+// the protocol settings are in timer ticks with lirrTimerTicks
+#ifdef lirrTimerTicks
+#define settingToMicros(value) ((uint32_t)(value) * 64000000UL / F_CPU)
+#else
+#define settingToMicros(value) ((uint32_t)(value))
+#endif
+
+static uint32_t randomState = 0x12345678;
+
+static uint32_t randomCode(uint8_t bits)
+{
+	uint32_t code;
+	do
+	{
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		code = (bits < 32) ? (randomState & ((1UL << bits) - 1)) : randomState;
+	} while (code == 0); // a code of zero is never reported
+	return code;
+}
+
+// the bits of a frame in the order they are sent, from a code whose most significant bit is sent first
+static std::vector<bool> sentBits(uint8_t bits, uint32_t frameBits)
+{
+	std::vector<bool> sent;
+	for (uint8_t bit = bits; bit--;)
+		sent.push_back((frameBits >> bit) & 1);
+	return sent;
+}
+
+static void pulseFractionFrame(const lirrPulseFractionSettings_t &settings, const std::vector<bool> &sent, std::vector<uint32_t> &durations)
+{
+	uint32_t bitShort = settingToMicros(settings.bitMin + settings.bitSep) / 2;
+	uint32_t bitLong = settingToMicros(settings.bitSep + settings.bitMax) / 2;
+	uint32_t start = settingToMicros(settings.startMin + settings.startMax) / 2;
+
+	if (settings.distanceMode)
+	{
+		// the time between the start of each mark is measured
+		if (settings.startMax)
+		{
+			durations.push_back(start / 2);
+			durations.push_back(start - start / 2);
+		}
+		for (size_t i = 0; i < sent.size(); i++)
+		{
+			uint32_t period = sent[i] ? bitLong : bitShort;
+			durations.push_back(bitShort / 2);
+			durations.push_back(period - bitShort / 2);
+		}
+		durations.push_back(bitShort / 2); // the final mark ends the last bit
+	}
+	else
+	{
+		// the length of each mark is measured
+		durations.push_back(start);
+		for (size_t i = 0; i < sent.size(); i++)
+		{
+			durations.push_back(bitShort);
+			durations.push_back(sent[i] ? bitLong : bitShort);
+		}
+	}
+}
+
+static void biPhaseFrame(const lirrBiPhaseSettings_t &settings, uint32_t code, bool toggle, std::vector<uint32_t> &durations)
+{
+	// find the time and level of each edge, starting with the mark that starts the frame
+	std::vector<uint32_t> edgeTimes(1, 0);
+	bool level = true;
+	uint32_t bitMid = settingToMicros(settings.startTime[0] + settings.startTime[1]) / 2;
+	uint32_t halfBit = settingToMicros(settings.bitTime[0] + settings.bitTime[1]) / 4;
+	uint32_t lastMid = 0;
+
+	for (uint8_t bit = settings.bits; bit--;)
+	{
+		bool value = (bit == settings.togglePos) ? toggle : ((code >> bit) & 1);
+		bool after = (value == settings.aceRising);
+
+		// the level must be the opposite of the new one just before each bit's middle
+		if (level == after)
+		{
+			edgeTimes.push_back((bit == settings.bits - 1) ? (bitMid - halfBit) : ((lastMid + bitMid) / 2));
+			level = !level;
+		}
+		edgeTimes.push_back(bitMid);
+		level = after;
+		lastMid = bitMid;
+
+		if ((bit == settings.togglePos + 1U) || (bit == settings.togglePos))
+			bitMid += settingToMicros(settings.toggleTime[0] + settings.toggleTime[1]) / 2;
+		else
+			bitMid += settingToMicros(settings.bitTime[0] + settings.bitTime[1]) / 2;
+	}
+	if (level)
+		edgeTimes.push_back(lastMid + halfBit);
+
+	// the frame always ends on a space, so the last duration is a mark
+	for (size_t i = 1; i < edgeTimes.size(); i++)
+		durations.push_back(edgeTimes[i] - edgeTimes[i-1]);
+}
+
+// the code that lirr should report for a frame, given the bits of the frame as they are sent
+// (the first bit sent is the most significant bit of frameBits), written bit by bit to check
+// the library's shifts and masks
+static uint32_t formattedCode(const lirrPulseFractionSettings_t &settings, uint32_t frameBits)
+{
+	std::vector<bool> sent = sentBits(settings.bits, frameBits);
+	if (settings.format & LIRR_CHECK_INVERTED)
+		sent.resize(sent.size() - 8);
+
+	// splits the bits sent into the fields, in the order they were sent
+	size_t commandBits = settings.commandBits ? settings.commandBits : sent.size();
+	size_t commandStart = (settings.format & LIRR_COMMAND_FIRST) ? 0 : (sent.size() - commandBits);
+	std::vector<bool> address, command;
+	for (size_t i = 0; i < sent.size(); i++)
+		((i >= commandStart) && (i < commandStart + commandBits) ? command : address).push_back(sent[i]);
+
+	uint32_t fields[2] = {0, 0};
+	const std::vector<bool> *pFields[2] = {&address, &command};
+	for (uint8_t f = 0; f < 2; f++)
+		for (size_t i = 0; i < pFields[f]->size(); i++)
+		{
+			size_t bit = (settings.format & LIRR_LSB_FIRST) ? i : (pFields[f]->size() - 1 - i);
+			fields[f] |= (uint32_t)(*pFields[f])[i] << bit;
+		}
+	return settings.commandBits ? ((fields[0] << 16) | fields[1]) : fields[1];
+}
+
+// the code that lirr should report for a frame with more than 32 bits: the FNV-1a hash of its bytes
+static uint32_t wideCode(const lirrPulseFractionSettings_t &settings, const std::vector<bool> &sent)
+{
+	std::vector<uint8_t> bytes((sent.size() + 7) / 8, 0);
+	for (size_t i = 0; i < sent.size(); i++)
+		if (sent[i])
+			bytes[i / 8] |= (settings.format & LIRR_LSB_FIRST) ? (1 << (i % 8)) : (0x80 >> (i % 8));
+	uint32_t hash = 2166136261UL;
+	for (size_t i = 0; i < bytes.size(); i++)
+		hash = (hash ^ bytes[i]) * 16777619UL;
+	return hash;
+}
+
+static frame_t syntheticFrame(const protocol_t &protocol)
+{
+	frame_t frame;
+	frame.protocol = protocol.name;
+	frame.codeKnown = true;
+	if (protocol.pPF && (protocol.pPF->bits > 32))
+	{
+		std::vector<bool> sent;
+		for (uint8_t bit = 0; bit < protocol.pPF->bits; bit++)
+			sent.push_back(randomCode(2) & 1);
+		frame.code = wideCode(*protocol.pPF, sent);
+		pulseFractionFrame(*protocol.pPF, sent, frame.durations);
+	}
+	else if (protocol.pPF)
+	{
+		// a code of zero is never reported
+		uint32_t frameBits;
+		do
+		{
+			frameBits = randomCode(protocol.pPF->bits);
+			if (protocol.pPF->format & LIRR_CHECK_INVERTED)
+				frameBits = (frameBits & ~0xFFUL) | (~frameBits >> 8 & 0xFF);
+			frame.code = formattedCode(*protocol.pPF, frameBits);
+		} while (frame.code == 0);
+		pulseFractionFrame(*protocol.pPF, sentBits(protocol.pPF->bits, frameBits), frame.durations);
+	}
+	else
+	{
+		// the toggle bit is not part of the code
+		bool toggle = randomCode(2) & 1;
+		do
+			frame.code = randomCode(protocol.pBP->bits) & ~(1UL << protocol.pBP->togglePos);
+		while (frame.code == 0);
+		biPhaseFrame(*protocol.pBP, frame.code, toggle, frame.durations);
+	}
+	return frame;
+}
+
+// inserts short marks into randomly chosen spaces of a frame
+static void addGlitches(frame_t &frame, unsigned count)
+{
+	const uint32_t glitchWidth = 50; // microseconds
+	for (unsigned added = 0, tries = 0; (added < count) && (tries < count * 16); tries++)
+	{
+		size_t space = (randomCode(16) % (frame.durations.size() / 2)) * 2 + 1;
+		if ((space >= frame.durations.size()) || (frame.durations[space] < glitchWidth * 4))
+			continue;
+
+		// split the space in two, with the glitch somewhere in its middle half
+		uint32_t before = frame.durations[space] / 4 + randomCode(16) % (frame.durations[space] / 2);
+		uint32_t after = frame.durations[space] - before - glitchWidth;
+		frame.durations[space] = before;
+		uint32_t insert[] = {glitchWidth, after};
+		frame.durations.insert(frame.durations.begin() + space + 1, insert, insert + 2);
+		added++;
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Trace files
+// ----------------------------------------------------------------------------------------------------
+
+static bool loadTrace(const char *fileName, std::vector<frame_t> &frames)
+{
+	FILE *pFile = fopen(fileName, "r");
+	if (!pFile)
+	{
+		fprintf(stderr, "can't open %s\n", fileName);
+		return false;
+	}
+
+	char line[4096];
+	unsigned lineNumber = 0;
+	while (fgets(line, sizeof(line), pFile))
+	{
+		lineNumber++;
+		char *pToken = strtok(line, " \t\r\n,");
+		if (!pToken || (pToken[0] == '#'))
+			continue;
+
+		frame_t frame;
+		frame.protocol = pToken;
+		pToken = strtok(NULL, " \t\r\n,");
+		frame.codeKnown = pToken && strcmp(pToken, "-");
+		frame.code = frame.codeKnown ? strtoul(pToken, NULL, 0) : 0;
+		while ((pToken = strtok(NULL, " \t\r\n,")) != NULL)
+			frame.durations.push_back(strtoul(pToken, NULL, 0));
+
+		if (!findProtocol(frame.protocol) || frame.durations.empty())
+		{
+			fprintf(stderr, "%s:%u: expected a protocol constant, a code and durations\n", fileName, lineNumber);
+			fclose(pFile);
+			return false;
+		}
+		frames.push_back(frame);
+	}
+	fclose(pFile);
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Replaying frames
+// ----------------------------------------------------------------------------------------------------
+
+#if defined(lirrInputCapture) || defined(lirrTimerTicks)
+static uint32_t timerTicks = 0; // free running Timer1 count (4us per tick at 16MHz)
+
+static void advanceTimer(void)
+{
+	uint32_t ticks = hostTime / (64000000UL / F_CPU);
+#if defined(lirrInputCapture) && !defined(lirrTimerTicks)
+	while (timerTicks >> 16 != ticks >> 16)
+	{
+		timerTicks = (timerTicks | 0xFFFF) + 1;
+		TIFR1.value |= _BV(TOV1);
+		TIMER1_OVF_vect();
+		TIFR1.value &= ~_BV(TOV1);
+	}
+#endif
+	timerTicks = ticks;
+	TCNT1 = ticks;
+}
+#endif
+
+#ifdef lirrGateTime
+static unsigned long gatedEdges = 0; // edges that came while the sensor's interrupt was turned off
+
+// Timer0 runs with a prescaler of 64 for millis(), and matches compare B once per overflow
+static void advanceTimer0(uint32_t time)
+{
+	const uint32_t overflowMicros = 64UL * 256UL * 1000UL / (F_CPU / 1000UL);
+	static uint32_t overflows = 0;
+	while (overflows != time / overflowMicros)
+	{
+		overflows++;
+		if (TIMSK0 & _BV(OCIE0B))
+			TIMER0_COMPB_vect();
+	}
+}
+#endif
+
+static void setTime(uint32_t time)
+{
+#ifdef lirrGateTime
+	advanceTimer0(time);
+#endif
+	hostTime = time;
+#if defined(lirrInputCapture) || defined(lirrTimerTicks)
+	advanceTimer();
+#endif
+}
+
+static void edge(bool mark)
+{
+	// the sensor pulls the pin low when IR is detected
+	if (mark)
+		PIND &= ~_BV(benchPin);
+	else
+		PIND |= _BV(benchPin);
+
+#if defined(lirrInputCapture)
+	ICR1 = TCNT1;
+	TIMER1_CAPT_vect();
+#elif defined(lirrExternalFeed)
+	// as a pin change ISR that's shared with other code would
+#ifdef lirrTimerTicks
+	lirrFeedEdge(!(PIND & _BV(benchPin)), TCNT1);
+#else
+	lirrFeedEdge(!(PIND & _BV(benchPin)), micros());
+#endif
+#else
+#if defined(lirrExternalInterrupt) && (lirrExternalInterruptSense == LIRR_FALLING_EDGE)
+	if (!mark)
+		return;
+#endif
+	// the interrupt only runs while it's turned on (lirrGateTime turns it off between frames)
+#ifdef lirrExternalInterrupt
+	bool enabled = EIMSK & _BV(INT0 + lirrExternalInterrupt);
+#else
+	bool enabled = PCMSK2 & _BV(benchPin);
+#endif
+	if (enabled)
+		benchVector();
+#ifdef lirrGateTime
+	else
+		gatedEdges++;
+#endif
+#endif
+}
+
+struct result_t
+{
+	unsigned frames, decoded, correct, wrongProtocol;
+	unsigned long edges;
+	double seconds;
+};
+
+// feeds one frame to the library, then waits for the button to be released
+// returns the code reported by lirrGetEvents, or 0 if there wasn't one
+static uint32_t replay(const frame_t &frame, result_t &result, uint8_t &protocol)
+{
+	using namespace std::chrono;
+
+	// leave a long space before each frame so that the decoders restart
+	uint32_t time = hostTime + 50000UL;
+	setTime(time);
+
+	steady_clock::time_point startTime = steady_clock::now();
+	for (size_t i = 0; i < frame.durations.size(); i++)
+	{
+		edge(!(i & 1));
+		time += frame.durations[i];
+		setTime(time);
+	}
+	if (frame.durations.size() & 1)
+		edge(false);
+	remoteEvents_t events = lirrGetEvents();
+	result.seconds += duration<double>(steady_clock::now() - startTime).count();
+	result.edges += frame.durations.size() + (frame.durations.size() & 1);
+
+	uint32_t code = (events.buttonState == BUTTON_PRESSED) ? events.buttonCode : 0;
+	protocol = lirrGetProtocol();
+#ifdef lirrWideCodes
+	// the bytes copied out must hash to the code
+	uint8_t bytes[lirrWideCodes];
+	uint8_t bits = lirrGetWideCode(bytes);
+	if (code && bits)
+	{
+		uint32_t hash = 2166136261UL;
+		for (uint8_t i = 0; i < (bits + 7) / 8; i++)
+			hash = (hash ^ bytes[i]) * 16777619UL;
+		if (hash != code)
+			code = 0;
+	}
+#endif
+
+	// let the button be released
+	for (uint8_t i = 0; (i < 4) && (events.buttonState != BUTTON_NONE); i++)
+	{
+		setTime(hostTime + repeatInt + 1000UL);
+		events = lirrGetEvents();
+	}
+	return code;
+}
+
+#ifdef LIRR_LEARNING_SUPPORTED
+// feeds one frame to learning mode
+static bool learnReplay(const frame_t &frame, lirrLearned_t &learned)
+{
+	uint32_t time = hostTime + 50000UL;
+	setTime(time);
+	for (size_t i = 0; i < frame.durations.size(); i++)
+	{
+		edge(!(i & 1));
+		time += frame.durations[i];
+		setTime(time);
+	}
+	if (frame.durations.size() & 1)
+		edge(false);
+	setTime(hostTime + 10000UL);
+	return lirrLearn(learned);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Gestures
+// A button is pressed and held for holdTime, with lirrGetGesture() called every millisecond, and the
+// gestures it returns (with the milliseconds since the press) are compared with the expected ones
+// ----------------------------------------------------------------------------------------------------
+
+struct gestureCheck_t
+{
+	const char *name;
+	lirrGestureSettings_t settings;
+	uint16_t holdTime;
+	const char *expected;
+};
+
+const gestureCheck_t gestureChecks[] = {
+	// the menu example in the API documentation, with the long press between the repeats
+	{"menu example", {800, 0, 500, 200, 40, 32}, 1000, "P0 R500 R700 L800 R875"},
+	// the long press before the first repeat, which must still be repeatFirst after it
+	{"long press first", {300, 0, 500, 200, 40, 0}, 1000, "P0 L300 R500 R700 R900"},
+	// a short press is only sent once doublePress has passed since the release
+	{"short press", {600, 300, 0, 0, 0, 0}, 100, "P400"}
+};
+const uint8_t gestureCheckCount = sizeof(gestureChecks) / sizeof(gestureChecks[0]);
+
+static std::string holdButton(const gestureCheck_t &check)
+{
+	const char names[] = " PDLR"; // by LIRR_GESTURE_ constant
+	const uint32_t start = 65000; // milliseconds, so that the low 16 bits of millis() wrap around
+	std::string result;
+	lirrGesture_t gesture = {};
+	remoteEvents_t events = {};
+	events.buttonCode = 0x20DF827D;
+	for (uint16_t t = 0; t < check.holdTime + 1000; t++)
+	{
+		setTime((start + t) * 1000UL);
+		if (t == 0)
+			events.buttonState = BUTTON_PRESSED;
+		else if (t < check.holdTime)
+			events.buttonState = BUTTON_HELD;
+		else if (t == check.holdTime)
+			events.buttonState = BUTTON_RELEASED;
+		else
+			events.buttonState = BUTTON_NONE;
+		uint8_t gestureResult = lirrGetGesture(gesture, events, check.settings);
+		if (gestureResult != LIRR_GESTURE_NONE)
+		{
+			if (!result.empty())
+				result += ' ';
+			result += names[gestureResult] + std::to_string(t);
+		}
+	}
+	return result;
+}
+
+static void printHeader(const char *title)
+{
+	printf("\n%s\n", title);
+	printf("%-20s %8s %8s %8s %8s %10s %12s\n", "protocol", "frames", "decoded", "correct", "edges", "ns/edge", "frames/s");
+}
+
+static void printResult(const char *name, const result_t &result)
+{
+	double nsPerEdge = result.edges ? (result.seconds * 1e9 / result.edges) : 0;
+	double framesPerSecond = (result.seconds > 0) ? (result.frames / result.seconds) : 0;
+	printf("%-20s %8u %8u %8u %8lu %10.1f %12.0f", name, result.frames, result.decoded, result.correct, result.edges, nsPerEdge, framesPerSecond);
+	if (result.wrongProtocol)
+		printf("  (%u reported as another protocol)", result.wrongProtocol);
+	printf("\n");
+}
+
+#ifdef lirrStats
+static void printStats(void)
+{
+	lirrStats_t stats = lirrGetStats();
+	printf("%20s edges %u, starts %u, frames %u, busy %u, bad bits %u, bad starts %u, bad bi-phase %u, bad checks %u\n", "",
+		stats.edges, stats.starts, stats.frames, stats.busy, stats.badBits, stats.badStarts, stats.badBiPhase, stats.badChecks);
+}
+#endif
+
+// replays the frames of one protocol, and returns the number that didn't decode to the expected code
+static unsigned benchProtocol(uint8_t index, const std::vector<frame_t> &frames, bool checkProtocol, result_t &result)
+{
+	unsigned failures = 0;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		if (frames[i].protocol != protocols[index].name)
+			continue;
+
+		uint8_t protocol;
+		uint32_t code = replay(frames[i], result, protocol);
+		result.frames++;
+		if (code)
+			result.decoded++;
+		if (checkProtocol && code && (protocol != index))
+			result.wrongProtocol++;
+		else if (frames[i].codeKnown && (code == frames[i].code))
+			result.correct++;
+		else if (frames[i].codeKnown)
+			failures++;
+	}
+	return failures;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+	unsigned framesPerProtocol = 1000;
+	unsigned glitchesPerFrame = 0;
+	std::vector<frame_t> frames;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && (i + 1 < argc))
+			framesPerProtocol = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-g") && (i + 1 < argc))
+			glitchesPerFrame = strtoul(argv[++i], NULL, 0);
+		else if (!loadTrace(argv[i], frames))
+			return 2;
+	}
+	bool traced = !frames.empty();
+	if (!traced)
+		for (uint8_t p = 0; p < protocolCount; p++)
+			for (unsigned i = 0; i < framesPerProtocol; i++)
+				frames.push_back(syntheticFrame(protocols[p]));
+	if (glitchesPerFrame)
+		for (size_t i = 0; i < frames.size(); i++)
+			addGlitches(frames[i], glitchesPerFrame);
+
+	unsigned failures = 0;
+
+#ifdef lirrStaticProtocol
+	// only the protocol selected in lightIRRecv.h can be decoded
+	lirrBegin(benchPin);
+	printHeader("lirrStaticProtocol");
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if ((protocols[p].pPF != (const void *)&lirrStaticProtocol) && (protocols[p].pBP != (const void *)&lirrStaticProtocol))
+			continue;
+		result_t result = {};
+		failures += benchProtocol(p, frames, false, result);
+		printResult(protocols[p].name, result);
+#ifdef lirrStats
+		printStats();
+#endif
+	}
+#else
+	// each protocol on its own
+	printHeader("single protocol");
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if (protocols[p].pPF)
+			lirrBegin(benchPin, *protocols[p].pPF);
+		else
+			lirrBegin(benchPin, *protocols[p].pBP);
+		result_t result = {};
+#ifdef lirrStats
+		lirrClearStats();
+#endif
+		failures += benchProtocol(p, frames, false, result);
+		if (result.frames)
+		{
+			printResult(protocols[p].name, result);
+#ifdef lirrStats
+			printStats();
+#endif
+		}
+	}
+
+	// each protocol on its own again, chosen from the table in flash
+	// an index that isn't in the table must be turned down, and leave the protocol as it was
+	printHeader("protocol table");
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		lirrBegin(benchPin, protocols[p].index);
+		if (lirrSetProtocol(lirrIndexCount))
+		{
+			printf("lirrSetProtocol(lirrIndexCount) was accepted\n");
+			failures++;
+		}
+		result_t result = {};
+		failures += benchProtocol(p, frames, false, result);
+		if (result.frames)
+			printResult(protocols[p].name, result);
+	}
+
+	// all of the protocols at the same time
+	// this is reported but doesn't count as a failure, since some protocols can be mistaken for others
+	// (PROTOCOL_SHARP has no start bit, and is only accepted if no other decoder is part way through a frame)
+	// protocols[] lists the pulse fraction protocols first, so its indexes match lirrGetProtocol()
+	const lirrPulseFractionSettings_t *pfProtocols[lirrMaxProtocols];
+	const lirrBiPhaseSettings_t *bpProtocols[lirrMaxProtocols];
+	uint8_t pfCount = 0, bpCount = 0;
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if (!protocols[p].multi)
+			continue;
+		if (protocols[p].pPF)
+			pfProtocols[pfCount++] = protocols[p].pPF;
+		else
+			bpProtocols[bpCount++] = protocols[p].pBP;
+	}
+	lirrBegin(benchPin, pfProtocols, pfCount, bpProtocols, bpCount);
+	printHeader("all protocols");
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if (!protocols[p].multi)
+			continue;
+		result_t result = {};
+		benchProtocol(p, frames, true, result);
+		if (result.frames)
+			printResult(protocols[p].name, result);
+	}
+
+#ifdef lirrWideCodes
+	// PROTOCOL_KASEIKYO has more than 32 bits, so none of its frames may be decoded in a list of protocols
+	const lirrPulseFractionSettings_t *wideProtocols[] = {&PROTOCOL_KASEIKYO};
+	lirrBegin(benchPin, wideProtocols, 1, bpProtocols, 0);
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if (protocols[p].pPF != &PROTOCOL_KASEIKYO)
+			continue;
+		result_t result = {};
+		benchProtocol(p, frames, false, result);
+		if (result.decoded)
+		{
+			printf("PROTOCOL_KASEIKYO was decoded in a list of protocols\n");
+			failures++;
+		}
+	}
+#endif
+
+	// and again, chosen from the table in flash
+	// PROTOCOL_KASEIKYO has more than 32 bits, so it must be left out of the list (without taking a place)
+	uint8_t protocolIndexes[lirrMaxProtocols + 1];
+	uint8_t indexCount = 0;
+#ifdef lirrWideCodes
+	protocolIndexes[indexCount++] = LIRR_INDEX_KASEIKYO;
+#endif
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if (protocols[p].multi)
+			protocolIndexes[indexCount++] = protocols[p].index;
+	}
+#ifdef lirrWideCodes
+	if (lirrBegin(benchPin, protocolIndexes, indexCount))
+	{
+		printf("PROTOCOL_KASEIKYO was accepted in a list of indexes\n");
+		failures++;
+	}
+#else
+	lirrBegin(benchPin, protocolIndexes, indexCount);
+#endif
+	printHeader("all protocols from the protocol table");
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if (!protocols[p].multi)
+			continue;
+		result_t result = {};
+		benchProtocol(p, frames, true, result);
+		if (result.frames)
+			printResult(protocols[p].name, result);
+	}
+
+#ifdef LIRR_LEARNING_SUPPORTED
+	// learning mode: each protocol is learned from a few presses of the same button (with the toggle
+	// bit changing), and then its frames are decoded with the learned settings
+	// with traces, the protocol's first few frames in them are learned from instead
+	// not every protocol can be learned, but one that was learned must decode all of its frames
+	printHeader("learned settings");
+	for (uint8_t p = 0; p < protocolCount; p++)
+	{
+		if (!protocols[p].multi)
+			continue;
+		std::vector<frame_t> learnFrames;
+		for (size_t i = 0; traced && (i < frames.size()) && (learnFrames.size() < 3); i++)
+		{
+			if (frames[i].protocol == protocols[p].name)
+				learnFrames.push_back(frames[i]);
+		}
+		if (traced && learnFrames.empty())
+			continue;
+		if (!traced)
+		{
+			frame_t learnFrame = syntheticFrame(protocols[p]);
+			for (uint8_t i = 0; i < 3; i++)
+			{
+				if (protocols[p].pBP)
+				{
+					learnFrame.durations.clear();
+					biPhaseFrame(*protocols[p].pBP, learnFrame.code, i & 1, learnFrame.durations);
+				}
+				learnFrames.push_back(learnFrame);
+			}
+		}
+		
+		lirrLearned_t learned;
+		lirrBeginLearning(benchPin, learned);
+		for (uint8_t i = 0; i < 3; i++)
+			learnReplay(learnFrames[i % learnFrames.size()], learned);
+		if (!learned.frames)
+		{
+			printf("%-20s not learned\n", protocols[p].name);
+			continue;
+		}
+
+		result_t result = {};
+		if (learned.encoding == LIRR_LEARN_BI_PHASE)
+		{
+			lirrBiPhaseSettings_t settings = lirrLearnedBiPhase(learned);
+			lirrBegin(benchPin, settings);
+			benchProtocol(p, frames, false, result);
+		}
+		else
+		{
+			lirrPulseFractionSettings_t settings = lirrLearnedPulseFraction(learned);
+			lirrBegin(benchPin, settings);
+			benchProtocol(p, frames, false, result);
+		}
+		printResult(protocols[p].name, result);
+		failures += result.frames - result.decoded;
+	}
+#endif
+#endif
+
+	// lirrGetGesture() (P press, D double press, L long press, R repeat)
+	printf("\ngestures\n");
+	unsigned gestureFailures = 0;
+	for (uint8_t i = 0; i < gestureCheckCount; i++)
+	{
+		std::string result = holdButton(gestureChecks[i]);
+		bool passed = (result == gestureChecks[i].expected);
+		printf("%-20s %-28s %s\n", gestureChecks[i].name, result.c_str(), passed ? "ok" : "expected");
+		if (!passed)
+		{
+			printf("%-20s %s\n", "", gestureChecks[i].expected);
+			gestureFailures++;
+		}
+	}
+
+#ifdef lirrGateTime
+	printf("\n%lu edges came while the sensor's interrupt was turned off\n", gatedEdges);
+#endif
+	if (failures)
+		printf("\n%u frames did not decode to the expected code\n", failures);
+	if (gestureFailures)
+		printf("\n%u gesture checks failed\n", gestureFailures);
+	return (failures || gestureFailures) ? 1 : 0;
+}
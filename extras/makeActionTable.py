@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""
+Light IR Receiver - action table generator
+
+Writes the action numbers and the sorted PROGMEM table for lirrGetAction() from a list of buttons,
+so that the table doesn't have to be sorted by hand. Each line of the input holds an action name
+followed by one or more button codes (as printed by the remoteTest example, in decimal or 0x hex):
+
+	POWER 551489775
+	VOLUME_UP 0x20DF40BF 0x20DFC03F
+
+Lines starting with # are ignored. Each action gets a number, starting at 1, in the order that the
+actions are listed. Usage:
+
+	makeActionTable.py buttons.txt [--name remoteActions] > remoteActions.h
+"""
+import argparse
+import sys
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Writes a lirrAction_t table for lirrGetAction().")
+	parser.add_argument("input", help="a file with an action name and its button codes on each line")
+	parser.add_argument("--name", default="remoteActions", help="the name of the table (default remoteActions)")
+	args = parser.parse_args()
+
+	actions = []
+	codes = {}
+	with open(args.input) as inputFile:
+		for lineNumber, line in enumerate(inputFile, 1):
+			fields = line.split()
+			if not fields or fields[0].startswith("#"):
+				continue
+			if len(fields) < 2:
+				sys.exit("%s:%d: expected an action name and its button codes" % (args.input, lineNumber))
+			name = fields[0].upper()
+			if name in actions:
+				sys.exit("%s:%d: %s is listed twice" % (args.input, lineNumber, name))
+			actions.append(name)
+			for field in fields[1:]:
+				code = int(field, 0)
+				if not 0 < code <= 0xFFFFFFFF:
+					sys.exit("%s:%d: %s isn't a button code" % (args.input, lineNumber, field))
+				if code in codes:
+					sys.exit("%s:%d: 0x%08X is already used by %s" % (args.input, lineNumber, code, codes[code]))
+				codes[code] = name
+
+	if not 0 < len(actions) < 256 or len(codes) > 255:
+		sys.exit("%s: expected 1 to 255 actions and codes" % args.input)
+
+	print("// written by makeActionTable.py from %s" % args.input)
+	print("#include <lightIRRecv.h>")
+	print("")
+	for number, name in enumerate(actions, 1):
+		print("const uint8_t ACTION_%s = %d;" % (name, number))
+	print("")
+	print("// sorted by code for lirrGetAction()")
+	print("const lirrAction_t %s[] PROGMEM = {" % args.name)
+	for code in sorted(codes):
+		print("\t{0x%08lXUL, ACTION_%s}," % (code, codes[code]))
+	print("};")
+	print("const uint8_t %sCount = sizeof(%s) / sizeof(%s[0]);" % (args.name, args.name, args.name))
+
+
+if __name__ == "__main__":
+	main()
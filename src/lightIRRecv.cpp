@@ -7,298 +7,2493 @@ License: GNU Lesser General Public License (LGPL) V2.1
 
 What it does:
 * Gives you a unique 32 bit number for each button.
-* Supports most of the common protocols, including NEC, Sony SIRC (12 bit), and RC5.
+* Supports most of the common protocols, including NEC, Sony SIRC (12, 15 and 20 bit), and RC5.
+* Can decode frames longer than 32 bits, such as Panasonic/Kaseikyo and air conditioner remotes (see lirrWideCodes).
 * Determines if a button has just been pressed, if it's being held down, and if it's just been released.
 * Gives you a time stamp of when the button was first pressed (good for "long pressed" events).
-* Can work with your sensor attached to any of digital pins 0 through 7 (minor software adjustment will permit attachment to any digital pin).
+* Can work with your sensor attached to any of digital pins 0 through 7 (a setting in lightIRRecv.h will permit attachment to other pins, or the use of INT0/INT1).
 * Allows you to specify your own protocols, provided that they use an existing protocol decoding function.
+* Can decode several protocols at the same time, and tell you which one was received.
+* Can decode several sensors at the same time, each with its own protocol.
 
 Limitations:
-* It doesn't auto-detect your remote's protocol.
+* It doesn't remember your remote's protocol.
 	* But you can use the "remoteTest" example sketch to figure out your remote's protocol.
-* It interprets all signals as being most significant bit first.
+* Unless you use the _STD protocol constants, it interprets all signals as being most significant bit first.
 	* So the button codes from this library will often differ from the official values.
-* It doesn't split the address code from the command code - they are combined together.
-* It doesn't split inverted verification codes from the non-inverted codes - they are combined together.
+	* The _STD constants split the address from the command, and check the inverted verification codes.
 
 */
 #include "lightIRRecv.h"
+#include <avr/sleep.h>
 
 // ----------------------------------------------------------------------------------------------------
 // Global data
 // ----------------------------------------------------------------------------------------------------
 
-static volatile uint32_t referenceTime;
-static uint32_t incomingCode;
+// the state of the decoder selected by lirrBegin()
+// its referenceTime is also used by lirrGetEvents() to detect released buttons
+static lirrDecoderState_t decoder;
+
 static remoteEvents_t remoteEvents = {0,0,0,BUTTON_NONE,false};
-#ifdef lirrTest
-static volatile uint32_t decodeTime = 0;
-static volatile uint32_t decodeCount = 0;
+#ifdef lirrQueueSize
+#if (lirrQueueSize & (lirrQueueSize - 1)) || (lirrQueueSize > 128)
+#error "lirrQueueSize must be a power of two, and no more than 128"
+#endif
+// single producer (ISR), single consumer (main loop) ring buffer
+// each side only writes its own index, so no interrupt disabling is needed
+static lirrFrame_t frameQueue[lirrQueueSize];
+static volatile uint8_t queueHead = 0; // only written by the ISR
+static volatile uint8_t queueTail = 0; // only written by the main loop
+static lirrTime_t lastFrameTime;
+static bool lastFrameToggle;
+#endif
+#ifdef lirrProfile
+static lirrProfile_t profile = {0,0xFFFF,0,{0},{0}};
+#endif
+#ifdef lirrStats
+static lirrStats_t stats;
 #endif
 
+#ifndef lirrStaticProtocol
 // pointers to settings structs
 static const lirrPulseFractionSettings_t *pPFSettings;
 static const lirrBiPhaseSettings_t *pBPSettings;
 
-// pointer to a function that will be called by the ISR
-static void (*pDecodeFunction)(bool pinState);
+// pointer to a function that will be called by the ISR
+static void (*pDecodeFunction)(bool pinState, lirrTime_t curTime);
+#endif
+
+#ifdef lirrEdgeBufferSize
+#if (lirrEdgeBufferSize & (lirrEdgeBufferSize - 1)) || (lirrEdgeBufferSize > 128)
+#error "lirrEdgeBufferSize must be a power of two, and no more than 128"
+#endif
+// single producer (ISR), single consumer (lirrProcess) ring buffer of edges
+// each entry is the time since the previous edge (saturated to 0xFFFE),
+// with the least significant bit replaced by the pin state
+static uint16_t edgeBuffer[lirrEdgeBufferSize];
+static volatile uint8_t edgeHead = 0; // only written by the ISR
+static volatile uint8_t edgeTail = 0; // only written by the main loop (lirrProcess() and lirrEnd())
+static volatile lirrTime_t lastEdgeTime; // time of the newest edge in the buffer
+#endif
+
+#ifdef lirrWideCodes
+#if (lirrWideCodes < 5) || (lirrWideCodes > 32)
+#error "lirrWideCodes must be 5 to 32 bytes"
+#endif
+// frames with more than 32 bits are received into wideIncoming, and copied to wideCode once
+// their code is accepted, so that wideCode always holds the frame of remoteEvents.buttonCode
+static uint8_t wideIncoming[lirrWideCodes];
+static uint8_t wideCode[lirrWideCodes];
+static uint8_t wideBits = 0; // the number of bits in wideCode
+#endif
+
+// the protocol (index in the lists passed to lirrBegin) that sent the code in remoteEvents
+static uint8_t codeProtocol;
+
+// changed by the ISR after each edge it decodes, see readLastSignal()
+static volatile uint8_t eventSequence = 0;
+
+// set by the ISR when lirrService() has something to do, see lirrOnEvent()
+static volatile bool serviceNeeded = false;
+static lirrEventCallback_t pEventCallback;
+
+// prevents the compiler from moving memory accesses across this point
+#define lirrBarrier() __asm__ __volatile__ ("" ::: "memory")
+
+// how long to wait for repeat codes, in the same units as the edge times
+static const lirrTime_t repeatTime = LIRR_US(repeatInt);
+
+// release detection for remoteEvents
+// if the protocol of the active code has a releaseTime, the button is released once no frame with the
+// same code (or repeat frame) has arrived for that long, otherwise once no edge has arrived for repeatTime
+static lirrTime_t frameTime; // when the last frame or repeat frame of the active code arrived
+static lirrTime_t releaseTime; // the releaseTime of the active code's protocol
+#ifndef lirrQueueSize
+static bool activeToggle; // the toggle bit of the active code (bi-phase protocols only)
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Profiling
+// Timer1 counts CPU cycles, unless it's being used to time edges (64 cycles per count)
+// ----------------------------------------------------------------------------------------------------
+
+#if defined(lirrProfile) || defined(lirrStats)
+static inline void saturatingIncrement(uint16_t &count)
+{
+	if (count != 0xFFFF)
+		count++;
+}
+#endif
+
+#ifdef lirrProfile
+
+#if defined(lirrInputCapture) || defined(lirrTimerTicks)
+static const uint8_t profileCycleShift = 6;
+#else
+static const uint8_t profileCycleShift = 0;
+#endif
+
+static inline void profileISR(uint16_t cycles)
+{
+	cycles <<= profileCycleShift;
+	if (cycles < profile.minCycles)
+		profile.minCycles = cycles;
+	if (cycles > profile.maxCycles)
+		profile.maxCycles = cycles;
+	
+	// bin n holds the ISRs that took less than (lirrProfileBinCycles << n) cycles
+	uint8_t bin = 0;
+	uint16_t binLimit = lirrProfileBinCycles;
+	while ((cycles >= binLimit) && (bin < (lirrProfileBins - 1)))
+	{
+		bin++;
+		binLimit <<= 1;
+	}
+	saturatingIncrement(profile.histogram[bin]);
+	saturatingIncrement(profile.count);
+}
+
+static inline void profileDecoder(uint8_t decoderType, uint16_t cycles)
+{
+	cycles <<= profileCycleShift;
+	if (cycles > profile.decoderMaxCycles[decoderType])
+		profile.decoderMaxCycles[decoderType] = cycles;
+}
+
+#define profileStart(startCount) uint16_t startCount = TCNT1
+#define profileISREnd(startCount) profileISR(TCNT1 - startCount)
+#define profileDecoderEnd(startCount, decoderType) profileDecoder(decoderType, TCNT1 - startCount)
+
+#else
+
+#define profileStart(startCount)
+#define profileISREnd(startCount)
+#define profileDecoderEnd(startCount, decoderType)
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Statistics
+// Counted by the ISR and the decoders, and compiled out unless lirrStats is defined
+// ----------------------------------------------------------------------------------------------------
+
+#ifdef lirrStats
+#define statsCount(counter) saturatingIncrement(stats.counter)
+#else
+#define statsCount(counter) ((void)0)
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Interrupt gating
+// Nothing can be decoded between the end of a frame and the start of the next, so the sensor's
+// interrupt is turned off after each frame, and TIMER0_COMPB_vect turns it back on lirrGateTime later
+// ----------------------------------------------------------------------------------------------------
+
+#ifdef lirrGateTime
+
+#if defined(lirrInputCapture) || defined(lirrEdgeBufferSize)
+#error "lirrGateTime can't be used with lirrInputCapture or lirrEdgeBufferSize"
+#endif
+
+// Timer0 overflows (and so matches compare B) every 1.024ms at 16MHz
+#if ((lirrGateTime) * (F_CPU / 1000UL) / (64UL * 256UL) < 1) || ((lirrGateTime) * (F_CPU / 1000UL) / (64UL * 256UL) > 254)
+#error "lirrGateTime must be between 2 and 260 (milliseconds, at 16MHz)"
+#endif
+static const uint8_t gateTicks = (uint32_t)(lirrGateTime) * (F_CPU / 1000UL) / (64UL * 256UL);
+
+static volatile uint8_t gateCount = 0; // compare matches left until the sensor's interrupt is turned back on
+#ifndef lirrExternalInterrupt
+static volatile uint8_t *pGatePCMSK; // the sensor's pin change mask register and bit (set by lirrInit())
+static uint8_t gatePCMSKBit;
+static uint8_t gatePCIFRBit;
+#endif
+
+// call with interrupts disabled (the ISR does)
+static inline void gateStart(void)
+{
+#ifdef lirrExternalInterrupt
+	EIMSK &= ~_BV(INT0 + lirrExternalInterrupt);
+#else
+	*pGatePCMSK &= ~gatePCMSKBit;
+#endif
+	// the first compare match can come right away, so count one more
+	gateCount = gateTicks + 1;
+	TIFR0 = _BV(OCF0B);
+	TIMSK0 |= _BV(OCIE0B);
+}
+
+// call with interrupts disabled
+static inline void gateStop(void)
+{
+	TIMSK0 &= ~_BV(OCIE0B);
+	gateCount = 0;
+}
+
+static inline void gateInit(uint8_t pinInterrupt)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	gateStop(); // a gate that's still counting down would turn the old pin's interrupt back on
+#ifdef lirrExternalInterrupt
+	(void)pinInterrupt;
+#else
+	pGatePCMSK = digitalPinToPCMSK(pinInterrupt);
+	gatePCMSKBit = 1 << digitalPinToPCMSKbit(pinInterrupt);
+	gatePCIFRBit = 1 << digitalPinToPCICRbit(pinInterrupt);
+#endif
+	SREG = oldSREG;
+}
+
+#else
+
+#define gateStart() ((void)0)
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Called by the decoders once a code is complete
+// Returns true if the code was accepted
+// ----------------------------------------------------------------------------------------------------
+
+static inline bool codeReady(const lirrDecoderState_t &state, lirrTime_t curTime, uint8_t protocol, lirrTime_t protocolReleaseTime)
+{
+	statsCount(frames);
+	gateStart();
+#ifdef lirrQueueSize
+	// lirrGetEvents() decides whether queued frames repeat the active code
+	frameTime = curTime;
+	releaseTime = protocolReleaseTime;
+	uint8_t head = queueHead;
+	if ((uint8_t)(head - queueTail) < lirrQueueSize)
+	{
+		lirrFrame_t &frame = frameQueue[head & (lirrQueueSize - 1)];
+		frame.code = state.incomingCode;
+		frame.time = curTime;
+		frame.toggle = state.incomingToggle;
+		frame.protocol = protocol;
+		lirrBarrier(); // the frame must be written before it is published
+		queueHead = head + 1;
+		serviceNeeded = true;
+		return true;
+	}
+	statsCount(busy); // the queue is full
+#else
+	(void)protocol; // only stored with the queue, see multiDecode() otherwise
+	if (remoteEvents.buttonState == BUTTON_NONE)
+	{
+		remoteEvents.buttonCode = state.incomingCode;
+		remoteEvents.pressTime = curTime;
+		remoteEvents.toggleState = !remoteEvents.toggleState;
+		frameTime = curTime;
+		releaseTime = protocolReleaseTime;
+		activeToggle = state.incomingToggle;
+		serviceNeeded = true;
+		return true;
+	}
+	
+	// a frame with the same code and toggle bit means that the button is still being held
+	// anything else is left to be picked up once the active button has been released
+	if ((state.incomingCode == remoteEvents.buttonCode) && (state.incomingToggle == activeToggle))
+		frameTime = curTime;
+	else
+		statsCount(busy);
+#endif
+	return false;
+}
+
+// called by the decoders for a repeat frame (eg, NEC's), which keeps the active code held
+static inline void repeatReady(lirrTime_t curTime)
+{
+	frameTime = curTime;
+	gateStart();
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Returned by the decoding functions below
+// ----------------------------------------------------------------------------------------------------
+
+static const uint8_t FRAME_NONE = 0;
+static const uint8_t FRAME_CODE = 1; // a complete code is in state.incomingCode
+static const uint8_t FRAME_REPEAT = 2; // a repeat frame, sent while a button is held (eg, NEC)
+
+// ----------------------------------------------------------------------------------------------------
+// Applies the format options of a pulse fraction protocol to a complete code
+// Runs once per frame. Frames that fail the inverted bits check return FRAME_NONE, so a corrupt
+// frame never reaches remoteEvents.
+// ----------------------------------------------------------------------------------------------------
+
+static inline uint8_t pulseFractionFinish(lirrDecoderState_t &state, const lirrPulseFractionSettings_t &settings)
+{
+	uint32_t code = state.incomingCode;
+	uint8_t bits = settings.bits;
+	bool lsbFirst = settings.format & LIRR_LSB_FIRST;
+	
+	if (lsbFirst)
+		code >>= (32 - bits);
+	
+	if (settings.format & LIRR_CHECK_INVERTED)
+	{
+		// the last 8 bits received are at the bottom of the code (MSB first) or at the top (LSB first)
+		bits -= 8;
+		uint8_t last = lsbFirst ? (code >> bits) : code;
+		uint8_t before = lsbFirst ? (code >> (bits - 8)) : (code >> 8);
+		if ((uint8_t)(last ^ before) != 0xFF)
+		{
+			statsCount(badChecks);
+			return FRAME_NONE;
+		}
+		code = lsbFirst ? (code & ((1UL << bits) - 1)) : (code >> 8);
+	}
+	
+	if (settings.commandBits)
+	{
+		// the command is at the bottom of the code if it was received last (MSB first) or first (LSB first)
+		bool commandLow = (lsbFirst == ((settings.format & LIRR_COMMAND_FIRST) != 0));
+		uint8_t lowBits = commandLow ? settings.commandBits : (bits - settings.commandBits);
+		uint32_t low = code & ((1UL << lowBits) - 1);
+		uint32_t high = code >> lowBits;
+		code = commandLow ? ((high << 16) | low) : ((low << 16) | high);
+	}
+	
+	state.incomingCode = code;
+	return FRAME_CODE;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// function for handling pulse width and pulse distance encoding
+// Returns FRAME_CODE once a complete code is in state.incomingCode
+// ----------------------------------------------------------------------------------------------------
+
+static inline uint8_t pulseFractionStep(lirrDecoderState_t &state, const lirrPulseFractionSettings_t &settings, bool pinState, lirrTime_t curTime)
+{
+	// measure from the start of each mark (pulse distance) or the end of each mark (pulse width)
+	// marks shorter than glitchTime are dropped with a single comparison, before they can end a frame early
+	switch (settings.distanceMode)
+	{
+		case true:
+		{
+#if defined(lirrExternalInterrupt) && (lirrExternalInterruptSense == LIRR_FALLING_EDGE)
+			// there are no rising edges, so the length of the mark isn't known
+			break;
+#else
+			// wait for the end of the mark to find out if it was a glitch
+			if (pinState)
+			{
+				state.markTime = curTime;
+				return FRAME_NONE;
+			}
+			if ((lirrTime_t)(curTime - state.markTime) < settings.glitchTime)
+				return FRAME_NONE;
+			curTime = state.markTime;
+			break;
+#endif
+		}
+		case false:
+		{
+			if (pinState)
+			{
+				state.referenceTime = curTime;
+				return FRAME_NONE;
+			}
+			if ((lirrTime_t)(curTime - state.referenceTime) < settings.glitchTime)
+				return FRAME_NONE;
+		}
+	}
+
+	lirrTime_t measuredTime = curTime - state.referenceTime;
+	state.referenceTime = curTime;
+	
+	switch (state.bitsRemaining == 0)
+	{
+		case false:
+		{
+			if ((measuredTime > settings.bitMin) && (measuredTime < settings.bitMax))
+			{
+				state.bitsRemaining--;
+
+				if (settings.format & LIRR_LSB_FIRST)
+				{
+					// shift each bit in from the top, pulseFractionFinish() moves the code down
+					state.incomingCode >>= 1;
+					if (measuredTime > settings.bitSep)
+						state.incomingCode |= 0x80000000UL;
+				}
+				else if (measuredTime > settings.bitSep)
+					state.incomingCode |= (1UL << state.bitsRemaining);
+				
+				return (state.bitsRemaining == 0) ? pulseFractionFinish(state, settings) : FRAME_NONE;
+			}
+			else
+			{
+				statsCount(badBits);
+				state.bitsRemaining = 0; // if unexpected timing occurs, immediately restart (the same edge may start a new frame)
+			}
+		}
+		case true:
+		{
+			if (
+				(((measuredTime < settings.startMax)
+					&& (measuredTime > settings.startMin))
+				|| (settings.startMax == 0))
+#ifdef lirrWideCodes
+				// frames that don't fit in incomingCode are never started (without lirrWideCodes, none of
+				// the protocol constants has more than 32 bits)
+				&& (settings.bits <= 32)
+#endif
+			)
+			{
+				statsCount(starts);
+				state.bitsRemaining = settings.bits;
+				state.incomingCode = 0;
+				state.incomingToggle = false;
+			}
+			else if ((measuredTime < settings.repeatMax) && (measuredTime > settings.repeatMin))
+				return FRAME_REPEAT;
+#ifdef lirrStats
+			else if ((measuredTime > settings.bitMax) && (measuredTime < (lirrTime_t)settings.startMax * 2))
+				statsCount(badStarts); // too long for a bit, but not a gap between frames
+#endif
+		}
+	}
+	return FRAME_NONE;
+}
+
+#ifndef lirrStaticProtocol
+static void pulseFractionDecode(bool pinState, lirrTime_t curTime)
+{
+	profileStart(decoderStartCount);
+	uint8_t frame = pulseFractionStep(decoder, *pPFSettings, pinState, curTime);
+	if (frame == FRAME_CODE)
+		codeReady(decoder, curTime, 0, pPFSettings->releaseTime);
+	else if (frame == FRAME_REPEAT)
+		repeatReady(curTime);
+	profileDecoderEnd(decoderStartCount, LIRR_PULSE_FRACTION);
+}
+#endif
+
+#ifdef lirrWideCodes
+
+// ----------------------------------------------------------------------------------------------------
+// function for handling pulse width and pulse distance protocols with more than 32 bits
+// The same as pulseFractionStep(), except that the bits are stored in wideIncoming, 8 to a byte
+// (the first bit received is the LSB of its byte with LIRR_LSB_FIRST, otherwise the MSB). The other
+// format options don't apply. Only used for protocols with more than 32 bits, so the others keep
+// their 32 bit shifts. Returns FRAME_CODE once a complete frame is in wideIncoming, with
+// state.incomingCode set to its FNV-1a hash.
+// ----------------------------------------------------------------------------------------------------
+
+static inline uint8_t pulseFractionWideStep(lirrDecoderState_t &state, const lirrPulseFractionSettings_t &settings, bool pinState, lirrTime_t curTime)
+{
+	switch (settings.distanceMode)
+	{
+		case true:
+		{
+#if defined(lirrExternalInterrupt) && (lirrExternalInterruptSense == LIRR_FALLING_EDGE)
+			break;
+#else
+			if (pinState)
+			{
+				state.markTime = curTime;
+				return FRAME_NONE;
+			}
+			if ((lirrTime_t)(curTime - state.markTime) < settings.glitchTime)
+				return FRAME_NONE;
+			curTime = state.markTime;
+			break;
+#endif
+		}
+		case false:
+		{
+			if (pinState)
+			{
+				state.referenceTime = curTime;
+				return FRAME_NONE;
+			}
+			if ((lirrTime_t)(curTime - state.referenceTime) < settings.glitchTime)
+				return FRAME_NONE;
+		}
+	}
+
+	lirrTime_t measuredTime = curTime - state.referenceTime;
+	state.referenceTime = curTime;
+	
+	switch (state.bitsRemaining == 0)
+	{
+		case false:
+		{
+			if ((measuredTime > settings.bitMin) && (measuredTime < settings.bitMax))
+			{
+				uint8_t bit = settings.bits - state.bitsRemaining; // counted from the start of the frame
+				uint8_t &frameByte = wideIncoming[bit >> 3];
+				if ((bit & 7) == 0)
+					frameByte = 0;
+				if (measuredTime > settings.bitSep)
+					frameByte |= (settings.format & LIRR_LSB_FIRST) ? (1 << (bit & 7)) : (0x80 >> (bit & 7));
+				
+				if (--state.bitsRemaining)
+					return FRAME_NONE;
+				
+				// the hash is only worked out once per frame
+				uint32_t hash = 2166136261UL;
+				for (uint8_t i = 0; i < (uint8_t)((settings.bits + 7) >> 3); i++)
+					hash = (hash ^ wideIncoming[i]) * 16777619UL;
+				state.incomingCode = hash;
+				return FRAME_CODE;
+			}
+			else
+			{
+				statsCount(badBits);
+				state.bitsRemaining = 0; // if unexpected timing occurs, immediately restart (the same edge may start a new frame)
+			}
+		}
+		case true:
+		{
+			// frames that don't fit in wideIncoming are never started
+			if (
+				(((measuredTime < settings.startMax)
+					&& (measuredTime > settings.startMin))
+				|| (settings.startMax == 0))
+				&& (settings.bits <= lirrWideCodes * 8)
+			)
+			{
+				statsCount(starts);
+				state.bitsRemaining = settings.bits;
+				state.incomingToggle = false;
+			}
+			else if ((measuredTime < settings.repeatMax) && (measuredTime > settings.repeatMin))
+				return FRAME_REPEAT;
+#ifdef lirrStats
+			else if ((measuredTime > settings.bitMax) && (measuredTime < (lirrTime_t)settings.startMax * 2))
+				statsCount(badStarts);
+#endif
+		}
+	}
+	return FRAME_NONE;
+}
+
+static inline void wideCodeReady(const lirrDecoderState_t &state, lirrTime_t curTime, const lirrPulseFractionSettings_t &settings)
+{
+	if (codeReady(state, curTime, 0, settings.releaseTime))
+	{
+		for (uint8_t i = 0; i < lirrWideCodes; i++)
+			wideCode[i] = wideIncoming[i];
+		wideBits = settings.bits;
+	}
+}
+
+#ifndef lirrStaticProtocol
+static void pulseFractionWideDecode(bool pinState, lirrTime_t curTime)
+{
+	profileStart(decoderStartCount);
+	uint8_t frame = pulseFractionWideStep(decoder, *pPFSettings, pinState, curTime);
+	if (frame == FRAME_CODE)
+		wideCodeReady(decoder, curTime, *pPFSettings);
+	else if (frame == FRAME_REPEAT)
+		repeatReady(curTime);
+	profileDecoderEnd(decoderStartCount, LIRR_PULSE_FRACTION);
+}
+#endif
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// function for handling bi-phase encoding
+// Returns FRAME_CODE once a complete code is in state.incomingCode
+// ----------------------------------------------------------------------------------------------------
+
+// the window for the middle of the next bit, which depends on how far through the frame it is
+static inline const uint16_t *biPhaseWindow(uint8_t bitsRemaining, const lirrBiPhaseSettings_t &settings)
+{
+	if (bitsRemaining == settings.bits)
+		return settings.startTime;
+	if ((bitsRemaining == (settings.togglePos+1)) || (bitsRemaining == settings.togglePos))
+		return settings.toggleTime;
+	return settings.bitTime;
+}
+
+static inline uint8_t biPhaseStep(lirrDecoderState_t &state, const lirrBiPhaseSettings_t &settings, bool pinState, lirrTime_t curTime)
+{
+	switch (state.bitsRemaining == 0)
+	{
+		case false:
+		{
+			lirrTime_t measuredTime = curTime - state.referenceTime;
+			const uint16_t *window = biPhaseWindow(state.bitsRemaining, settings);
+
+			if (measuredTime <= window[0])
+			{
+				// an edge between two bits, which comes half a bit after the middle of the first one
+				// state.markTime holds an edge that came sooner than that (eg, the end of a short mark from a
+				// pulse distance protocol), and it's let go if the next edge comes soon after it (a glitch)
+				if (state.markTime != state.referenceTime)
+					state.markTime = ((lirrTime_t)(curTime - state.markTime) < (settings.bitTime[0] >> 2)) ? state.referenceTime : curTime;
+				else if (measuredTime < (settings.bitTime[0] >> 1))
+					state.markTime = curTime;
+				break;
+			}
+			if ((measuredTime < window[1]) && (state.markTime == state.referenceTime))
+			{
+				// we're at the middle of a bit
+				state.referenceTime = curTime;
+				state.markTime = curTime;
+				
+				state.bitsRemaining--;
+				if (pinState == settings.aceRising)
+				{
+					if (state.bitsRemaining != settings.togglePos)
+						state.incomingCode += (1UL << state.bitsRemaining);
+					else
+						state.incomingToggle = true;
+				}
+				
+				// if we've received all the bits, indicate that the code is ready
+				if (state.bitsRemaining == 0)
+					return FRAME_CODE;
+				break;
+			}
+			statsCount(badBiPhase);
+			state.bitsRemaining = 0; // if unexpected timing occurs, immediately restart
+		}		
+		case true:
+		{
+			// wait for a rising edge
+			if (pinState)
+			{
+				statsCount(starts);
+				state.bitsRemaining = settings.bits;
+				state.incomingCode = 0;
+				state.incomingToggle = false;
+				state.referenceTime = curTime;
+				state.markTime = curTime;
+			}
+		}
+	}
+	return FRAME_NONE;
+}
+
+// the decoding functions below are only called through pDecodeFunction, which lirrStaticProtocol doesn't use
+#ifndef lirrStaticProtocol
+
+static void biPhaseDecode(bool pinState, lirrTime_t curTime)
+{
+	profileStart(decoderStartCount);
+	if (biPhaseStep(decoder, *pBPSettings, pinState, curTime) == FRAME_CODE)
+		codeReady(decoder, curTime, 0, pBPSettings->releaseTime);
+	profileDecoderEnd(decoderStartCount, LIRR_BI_PHASE);
+}
+
+// ----------------------------------------------------------------------------------------------------
+// function for running several decoders side by side, used to detect the protocol
+// Each protocol passed to lirrBegin() gets its own decoder state
+// ----------------------------------------------------------------------------------------------------
+
+static lirrDecoderState_t multiDecoders[lirrMaxProtocols];
+static const lirrPulseFractionSettings_t *const *pMultiPFSettings;
+static const lirrBiPhaseSettings_t *const *pMultiBPSettings;
+static uint8_t multiPFCount;
+static uint8_t multiBPCount;
+
+// returns true if any decoder other than *pState is part way through a frame
+// The bi-phase decoders start on any rising edge, so they only count once they've received a bit,
+// and until a bit time after their last one (the end of their last mark can complete a Sharp code).
+static bool otherDecoderBusy(const lirrDecoderState_t *pState, lirrTime_t curTime)
+{
+	const lirrDecoderState_t *pOther = multiDecoders;
+	for (uint8_t i = 0; i < multiPFCount; i++, pOther++)
+	{
+		if ((pOther != pState) && pOther->bitsRemaining)
+			return true;
+	}
+	for (uint8_t i = 0; i < multiBPCount; i++, pOther++)
+	{
+		if (pOther->bitsRemaining ? (pOther->bitsRemaining < (pMultiBPSettings[i]->bits - 1))
+			: ((lirrTime_t)(curTime - pOther->referenceTime) < pMultiBPSettings[i]->bitTime[1]))
+			return true;
+	}
+	return false;
+}
+
+static void multiDecode(bool pinState, lirrTime_t curTime)
+{
+	lirrDecoderState_t *pState = multiDecoders;
+	uint8_t protocol = 0;
+	
+	for (uint8_t i = 0; i < multiPFCount; i++, pState++, protocol++)
+	{
+		profileStart(decoderStartCount);
+		uint8_t frame = pulseFractionStep(*pState, *pMultiPFSettings[i], pinState, curTime);
+		profileDecoderEnd(decoderStartCount, LIRR_PULSE_FRACTION);
+		if (frame == FRAME_CODE)
+		{
+			// protocols without a start burst (eg, Sharp) will happily decode part of any other
+			// protocol's frame, so only accept their codes if nothing else is receiving a frame
+			if ((pMultiPFSettings[i]->startMax == 0) && otherDecoderBusy(pState, curTime))
+				continue;
+			if (codeReady(*pState, curTime, protocol, pMultiPFSettings[i]->releaseTime))
+				codeProtocol = protocol;
+		}
+		else if ((frame == FRAME_REPEAT) && (protocol == codeProtocol))
+			repeatReady(curTime);
+	}
+	for (uint8_t i = 0; i < multiBPCount; i++, pState++, protocol++)
+	{
+		profileStart(decoderStartCount);
+		bool codeComplete = (biPhaseStep(*pState, *pMultiBPSettings[i], pinState, curTime) == FRAME_CODE);
+		profileDecoderEnd(decoderStartCount, LIRR_BI_PHASE);
+		if (codeComplete)
+		{
+			if (codeReady(*pState, curTime, protocol, pMultiBPSettings[i]->releaseTime))
+				codeProtocol = protocol;
+		}
+	}
+	
+	// the decoders are all listening to the same signal
+	decoder.referenceTime = curTime;
+}
+
+#endif
+
+#ifdef LIRR_RECEIVERS_SUPPORTED
+
+// ----------------------------------------------------------------------------------------------------
+// functions for decoding several sensors that share the pin change interrupt
+// Each receiver has its own decoder state and events, and the ISR works out which pins changed
+// ----------------------------------------------------------------------------------------------------
+
+static lirrReceiver_t *pReceivers; // linked list of receivers
+static volatile uint8_t *pReceiverPort; // the input register of the port the sensors are on
+static uint8_t receiverPinLevels; // the state of the port as of the last interrupt
+
+// same as codeReady(), for a receiver (which only has the one protocol)
+static inline void receiverCodeReady(lirrReceiver_t &receiver, lirrTime_t curTime, lirrTime_t protocolReleaseTime)
+{
+	const lirrDecoderState_t &state = receiver.decoder;
+	statsCount(frames);
+	if (receiver.remoteEvents.buttonState == BUTTON_NONE)
+	{
+		receiver.remoteEvents.buttonCode = state.incomingCode;
+		receiver.remoteEvents.pressTime = curTime;
+		receiver.remoteEvents.toggleState = !receiver.remoteEvents.toggleState;
+		receiver.frameTime = curTime;
+		receiver.releaseTime = protocolReleaseTime;
+		receiver.activeToggle = state.incomingToggle;
+	}
+	else if ((state.incomingCode == receiver.remoteEvents.buttonCode) && (state.incomingToggle == receiver.activeToggle))
+		receiver.frameTime = curTime;
+	else
+		statsCount(busy);
+}
+
+static void receiverPulseFractionDecode(lirrReceiver_t &receiver, bool pinState, lirrTime_t curTime)
+{
+	const lirrPulseFractionSettings_t &settings = *(const lirrPulseFractionSettings_t *)receiver.pSettings;
+	profileStart(decoderStartCount);
+	uint8_t frame = pulseFractionStep(receiver.decoder, settings, pinState, curTime);
+	if (frame == FRAME_CODE)
+		receiverCodeReady(receiver, curTime, settings.releaseTime);
+	else if (frame == FRAME_REPEAT)
+		receiver.frameTime = curTime;
+	profileDecoderEnd(decoderStartCount, LIRR_PULSE_FRACTION);
+}
+
+static void receiverBiPhaseDecode(lirrReceiver_t &receiver, bool pinState, lirrTime_t curTime)
+{
+	const lirrBiPhaseSettings_t &settings = *(const lirrBiPhaseSettings_t *)receiver.pSettings;
+	profileStart(decoderStartCount);
+	if (biPhaseStep(receiver.decoder, settings, pinState, curTime) == FRAME_CODE)
+		receiverCodeReady(receiver, curTime, settings.releaseTime);
+	profileDecoderEnd(decoderStartCount, LIRR_BI_PHASE);
+}
+
+// called through pDecodeFunction; the pin state passed by the ISR isn't used, since the
+// port has to be read to find out which sensors caused the interrupt
+static void receiverDemux(bool, lirrTime_t curTime)
+{
+	uint8_t pinLevels = *pReceiverPort;
+	uint8_t changedPins = pinLevels ^ receiverPinLevels;
+	receiverPinLevels = pinLevels;
+	
+	for (lirrReceiver_t *pReceiver = pReceivers; pReceiver; pReceiver = pReceiver->pNext)
+	{
+		if (changedPins & pReceiver->pinMask)
+			pReceiver->pDecodeFunction(*pReceiver, !(pinLevels & pReceiver->pinMask), curTime); // pin is low while IR is detected
+	}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Passes an edge to the decoder
+// With lirrStaticProtocol, the decoder is called directly, and the overloads below pick the
+// decoding function at compile time. The protocol's timing values then become constants.
+// ----------------------------------------------------------------------------------------------------
+
+#ifdef lirrStaticProtocol
+
+static inline void staticDecode(const lirrPulseFractionSettings_t &settings, bool pinState, lirrTime_t curTime)
+{
+#ifdef lirrWideCodes
+	// settings.bits is a constant here, so only one of the decoders is compiled in
+	if (settings.bits > 32)
+	{
+		profileStart(decoderStartCount);
+		uint8_t frame = pulseFractionWideStep(decoder, settings, pinState, curTime);
+		if (frame == FRAME_CODE)
+			wideCodeReady(decoder, curTime, settings);
+		else if (frame == FRAME_REPEAT)
+			repeatReady(curTime);
+		profileDecoderEnd(decoderStartCount, LIRR_PULSE_FRACTION);
+		return;
+	}
+#endif
+	profileStart(decoderStartCount);
+	uint8_t frame = pulseFractionStep(decoder, settings, pinState, curTime);
+	if (frame == FRAME_CODE)
+		codeReady(decoder, curTime, 0, settings.releaseTime);
+	else if (frame == FRAME_REPEAT)
+		repeatReady(curTime);
+	profileDecoderEnd(decoderStartCount, LIRR_PULSE_FRACTION);
+}
+
+static inline void staticDecode(const lirrBiPhaseSettings_t &settings, bool pinState, lirrTime_t curTime)
+{
+	profileStart(decoderStartCount);
+	if (biPhaseStep(decoder, settings, pinState, curTime) == FRAME_CODE)
+		codeReady(decoder, curTime, 0, settings.releaseTime);
+	profileDecoderEnd(decoderStartCount, LIRR_BI_PHASE);
+}
+
+#endif
+
+static inline void decodeEdge(bool pinState, lirrTime_t curTime)
+{
+#ifdef lirrStaticProtocol
+	staticDecode(lirrStaticProtocol, pinState, curTime);
+#else
+	pDecodeFunction(pinState, curTime);
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Called by the ISRs for each edge
+// Either calls the decoding function right away, or leaves the edge for lirrProcess()
+// ----------------------------------------------------------------------------------------------------
+
+static inline void edgeReceived(bool pinState, lirrTime_t curTime)
+{
+	statsCount(edges);
+#ifdef lirrEdgeBufferSize
+	uint8_t head = edgeHead;
+	if ((uint8_t)(head - edgeTail) < lirrEdgeBufferSize)
+	{
+		// if the buffer is full, the edge is dropped and lastEdgeTime is left alone
+		// so that the next edge's time is still correct
+		lirrTime_t edgeTime = curTime - lastEdgeTime;
+		if (edgeTime > 0xFFFE)
+			edgeTime = 0xFFFE;
+		edgeBuffer[head & (lirrEdgeBufferSize - 1)] = ((uint16_t)edgeTime & 0xFFFE) | pinState;
+		lastEdgeTime = curTime;
+		lirrBarrier(); // the edge must be written before it is published
+		edgeHead = head + 1;
+		serviceNeeded = true; // the edges are decoded by lirrGetEvents()
+	}
+#else
+	decodeEdge(pinState, curTime);
+	eventSequence++;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+// ISRs that timestamp each edge and pass it on
+// ----------------------------------------------------------------------------------------------------
+
+#if defined(lirrInputCapture) && defined(lirrExternalInterrupt)
+#error "lirrInputCapture and lirrExternalInterrupt can't be used together"
+#endif
+#if defined(lirrExternalFeed) && (defined(lirrInputCapture) || defined(lirrExternalInterrupt) || defined(lirrGateTime) || defined(lirrProfile))
+#error "lirrExternalFeed can't be used with lirrInputCapture, lirrExternalInterrupt, lirrGateTime or lirrProfile"
+#endif
+
+#if defined(lirrInputCapture) && !defined(lirrTimerTicks)
+
+#if (64000000UL % F_CPU) != 0
+#error "lirrInputCapture needs a clock speed that gives a whole number of microseconds per 64 cycles"
+#endif
+
+// Timer1 runs with a prescaler of 64, which gives the same resolution as micros() (4us at 16MHz)
+// A 16 bit overflow count extends the timer to the same 32 bit microsecond range as micros()
+static const uint8_t captureTickTime = 64000000UL / F_CPU; // microseconds per timer tick
+static volatile uint16_t captureOverflows;
+
+static inline uint32_t captureToMicros(uint16_t timerCount)
+{
+	// call with interrupts disabled
+	// if the timer has overflowed but the overflow ISR hasn't run yet, account for it here
+	uint16_t overflows = captureOverflows;
+	if ((TIFR1 & _BV(TOV1)) && (timerCount < 0x8000))
+		overflows++;
+	return (((uint32_t)overflows << 16) | timerCount) * captureTickTime;
+}
+
+ISR(TIMER1_OVF_vect)
+{
+	captureOverflows++;
+}
+
+#endif
+
+// returns the current time in the same units as the edge times
+// call with interrupts disabled
+static inline lirrTime_t currentTime(void)
+{
+#if defined(lirrTimerTicks)
+	// Timer1 runs with a prescaler of 64, and its count is used as is (4us per tick at 16MHz)
+	return TCNT1;
+#elif defined(lirrInputCapture)
+	return captureToMicros(TCNT1);
+#else
+	return micros();
+#endif
+}
+
+#ifdef lirrTimerTicks
+// converts a tick count from the last 262ms (at 16MHz) to the micros() timebase
+static inline uint32_t ticksToMicros(lirrTime_t ticks, lirrTime_t nowTicks, uint32_t nowMicros)
+{
+	return nowMicros - ((uint32_t)(lirrTime_t)(nowTicks - ticks) * 64000UL / (F_CPU / 1000UL));
+}
+#endif
+
+#if !defined(lirrInputCapture) && !defined(lirrExternalFeed) && !(defined(lirrExternalInterrupt) && (lirrExternalInterruptSense == LIRR_FALLING_EDGE))
+// the ISR reads the sensor's pin instead of keeping track of it, so a missed edge can't invert the
+// pin state of the edges that follow, and pin changes on the other pins of the port are ignored
+#define LIRR_READS_PIN
+static volatile uint8_t *pPinPort; // the input register of the port the sensor is on (set by lirrInit())
+static uint8_t pinMask; // the sensor's bit in *pPinPort (the bits of all of the receivers' sensors with receivers)
+static uint8_t lastPinLevel; // *pPinPort & pinMask as of the last edge
+
+// returns true and sets pinState (true while IR is detected) if the sensor's pin has changed
+static inline bool readPin(bool &pinState)
+{
+	uint8_t pinLevel = *pPinPort & pinMask;
+	if (pinLevel == lastPinLevel)
+		return false;
+	lastPinLevel = pinLevel;
+	pinState = !pinLevel; // pin is low while IR is detected
+	return true;
+}
+#endif
+
+#ifdef lirrInputCapture
+
+ISR(TIMER1_CAPT_vect)
+{
+	profileStart(isrStartCount);
+#ifdef lirrTimerTicks
+	lirrTime_t curTime = ICR1;
+#else
+	lirrTime_t curTime = captureToMicros(ICR1);
+#endif
+	
+	// the capture unit only looks for one type of edge at a time, so switch to the other type
+	// the edge that was just captured is falling (IR detected) if we were looking for a falling edge
+	bool pinState = !(TCCR1B & _BV(ICES1));
+	TCCR1B ^= _BV(ICES1);
+	TIFR1 = _BV(ICF1); // changing the edge type can cause a false capture, so clear it
+	
+	edgeReceived(pinState, curTime);
+	profileISREnd(isrStartCount);
+}
+
+#elif defined(lirrExternalInterrupt)
+
+#if lirrExternalInterrupt == 0
+ISR(INT0_vect)
+#elif lirrExternalInterrupt == 1
+ISR(INT1_vect)
+#else
+#error "lirrExternalInterrupt must be 0 (INT0) or 1 (INT1)"
+#endif
+{
+	profileStart(isrStartCount);
+#if lirrExternalInterruptSense == LIRR_FALLING_EDGE
+	// only falling edges (IR detected) cause an interrupt
+	edgeReceived(true, currentTime());
+#else
+	bool pinState;
+	if (readPin(pinState))
+		edgeReceived(pinState, currentTime());
+#endif
+	profileISREnd(isrStartCount);
+}
+
+#elif defined(lirrExternalFeed)
+
+// ----------------------------------------------------------------------------------------------------
+// With lirrExternalFeed, the ISR is someone else's, and it calls this for each edge
+// ----------------------------------------------------------------------------------------------------
+
+static bool fedPinState = false; // the pinState of the last edge fed (the sensor starts out idle)
+
+void lirrFeedEdge(bool pinState, lirrTime_t edgeTime)
+{
+	// a shared pin change ISR can call this for a change of any pin on the port
+	if (pinState == fedPinState)
+		return;
+	fedPinState = pinState;
+	edgeReceived(pinState, edgeTime);
+}
+
+#else
+
+ISR(lirrPinChangeVector)
+{
+	profileStart(isrStartCount);
+	bool pinState;
+	if (readPin(pinState))
+		edgeReceived(pinState, currentTime());
+	profileISREnd(isrStartCount);
+}
+
+#endif
+
+#ifdef lirrGateTime
+
+// counts down the gate after each frame, then turns the sensor's interrupt back on
+ISR(TIMER0_COMPB_vect)
+{
+	if (--gateCount)
+		return;
+	TIMSK0 &= ~_BV(OCIE0B);
+#ifdef LIRR_READS_PIN
+	// the edges while the interrupt was off were never seen, so carry on from the pin's level now
+	lastPinLevel = *pPinPort & pinMask;
+#endif
+#ifdef lirrExternalInterrupt
+	EIFR = _BV(INTF0 + lirrExternalInterrupt);
+	EIMSK |= _BV(INT0 + lirrExternalInterrupt);
+#else
+	PCIFR = gatePCIFRBit;
+	*pGatePCMSK |= gatePCMSKBit;
+#endif
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Sets up the pin change interrupt
+// ----------------------------------------------------------------------------------------------------
+
+#if !defined(lirrInputCapture) && !defined(lirrExternalInterrupt) && !defined(lirrExternalFeed)
+static uint8_t sensorPin;
+#endif
+
+static inline void lirrInit(uint8_t pinInterrupt)
+{
+	// pull sensor pin high
+	pinMode(pinInterrupt, INPUT_PULLUP); 
+	
+#ifdef LIRR_READS_PIN
+	uint8_t oldSREG = SREG;
+	cli();
+	pPinPort = portInputRegister(digitalPinToPort(pinInterrupt));
+	pinMask = digitalPinToBitMask(pinInterrupt);
+	lastPinLevel = *pPinPort & pinMask;
+	SREG = oldSREG;
+#endif
+	
+#ifdef lirrGateTime
+	gateInit(pinInterrupt);
+#endif
+	
+#if defined(lirrProfile) && !defined(lirrInputCapture) && !defined(lirrTimerTicks)
+	// Set up Timer1 in normal mode with no prescaler, so that it counts CPU cycles
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);
+#elif defined(lirrTimerTicks) && !defined(lirrInputCapture)
+	// Set up Timer1 in normal mode with a prescaler of 64, so that it counts edge times
+	TCCR1A = 0;
+	TCCR1B = _BV(CS11) | _BV(CS10);
+#endif
+	
+#ifdef lirrInputCapture
+	// Set up Timer1 in normal mode with a prescaler of 64 and the input capture noise canceler on
+	// Need to put the sensor on the ICP1 pin
+	uint8_t oldSREG = SREG;
+	cli();
+	TCCR1A = 0;
+	TCCR1B = _BV(ICNC1) | _BV(CS11) | _BV(CS10); // start by capturing a falling edge
+	TIFR1 = _BV(ICF1) | _BV(TOV1); // clear interrupts
+#ifdef lirrTimerTicks
+	TIMSK1 = _BV(ICIE1); // enable the capture interrupt (the 16 bit count is used as is)
+#else
+	TIMSK1 = _BV(ICIE1) | _BV(TOIE1); // enable the capture and overflow interrupts
+#endif
+	SREG = oldSREG;
+#elif defined(lirrExternalInterrupt)
+	// Set up the external interrupt
+	// Need to put the sensor on the INT0 or INT1 pin
+	const uint8_t senseShift = lirrExternalInterrupt * (ISC10 - ISC00);
+	EICRA = (EICRA & ~(3 << senseShift)) | (lirrExternalInterruptSense << senseShift); // set the edge type
+	EIFR = _BV(INTF0 + lirrExternalInterrupt); // clear interrupt
+	EIMSK |= _BV(INT0 + lirrExternalInterrupt); // enable the interrupt
+#elif defined(lirrExternalFeed)
+	// the edges come from lirrFeedEdge(), so there's no interrupt to set up
+	uint8_t oldSREG = SREG;
+	cli();
+	fedPinState = false;
+	SREG = oldSREG;
+#else
+	// Set up a pin change interrupt
+	// Need to put the sensor on one of the pins that belong to lirrPinChangeVector
+	sensorPin = pinInterrupt; // for lirrEnd()
+    *digitalPinToPCMSK(pinInterrupt) |= (1 << digitalPinToPCMSKbit(pinInterrupt));  // enable the pin in the PCI mask
+	uint8_t PCICRBitMask = 1 << digitalPinToPCICRbit(pinInterrupt);
+    PCIFR |= PCICRBitMask; // clear interrupt
+    PCICR |= PCICRBitMask; // enable PCI for the port the pin is on
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+// These functions set up pointers to the protocol settings and decoding function
+// And call the initialization function above
+// Having overloaded lirrBegin() functions for each decoding function is what allows the
+// unused decoding functions to be optimized out.
+//
+// The pointer to the protocol struct is typecast to a pointer to its first member (this is legal)
+// and it is also legal to go back again (the reverse typecast occurs in the decoding functions)
+// this library exploits this to acchieve polymorphism-like behavior with POD structs
+// ----------------------------------------------------------------------------------------------------
+
+#ifdef lirrStaticProtocol
+
+void lirrBegin(uint8_t pinInterrupt)
+{
+	lirrInit(pinInterrupt);
+}
+
+#else
+
+void lirrBegin(uint8_t pinInterrupt, const lirrPulseFractionSettings_t &remoteProtocol)
+{
+	lirrSetProtocol(remoteProtocol);
+	lirrInit(pinInterrupt);
+}
+
+void lirrBegin(uint8_t pinInterrupt, const lirrBiPhaseSettings_t &remoteProtocol)
+{
+	lirrSetProtocol(remoteProtocol);
+	lirrInit(pinInterrupt);
+}
+
+void lirrBegin(uint8_t pinInterrupt,
+	const lirrPulseFractionSettings_t *const pfProtocols[], uint8_t pfCount,
+	const lirrBiPhaseSettings_t *const bpProtocols[], uint8_t bpCount)
+{
+	lirrSetProtocol(pfProtocols, pfCount, bpProtocols, bpCount);
+	lirrInit(pinInterrupt);
+}
+
+// ----------------------------------------------------------------------------------------------------
+// These functions swap the protocol without touching the pin and interrupt set up by lirrBegin()
+// The ISR is held off while the settings, decoding function and decoder state change together, so
+// an edge is either decoded with the old protocol or the new one. The events are cleared, since a
+// button received with the old protocol would never be released by the new one.
+// ----------------------------------------------------------------------------------------------------
+
+void lirrSetProtocol(const lirrPulseFractionSettings_t &remoteProtocol)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	pPFSettings = &remoteProtocol;
+#ifdef lirrWideCodes
+	pDecodeFunction = (remoteProtocol.bits > 32) ? pulseFractionWideDecode : pulseFractionDecode;
+#else
+	pDecodeFunction = pulseFractionDecode;
+#endif
+	decoder.bitsRemaining = 0;
+	lirrClearEvents();
+	SREG = oldSREG;
+}
+
+void lirrSetProtocol(const lirrBiPhaseSettings_t &remoteProtocol)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	pBPSettings = &remoteProtocol;
+	pDecodeFunction = biPhaseDecode;
+	decoder.bitsRemaining = 0;
+	lirrClearEvents();
+	SREG = oldSREG;
+}
+
+void lirrSetProtocol(const lirrPulseFractionSettings_t *const pfProtocols[], uint8_t pfCount,
+	const lirrBiPhaseSettings_t *const bpProtocols[], uint8_t bpCount)
+{
+	if (pfCount > lirrMaxProtocols)
+		pfCount = lirrMaxProtocols;
+	if (bpCount > (lirrMaxProtocols - pfCount))
+		bpCount = lirrMaxProtocols - pfCount;
+	
+	uint8_t oldSREG = SREG;
+	cli();
+	pMultiPFSettings = pfProtocols;
+	multiPFCount = pfCount;
+	pMultiBPSettings = bpProtocols;
+	multiBPCount = bpCount;
+	pDecodeFunction = multiDecode;
+	for (uint8_t i = 0; i < lirrMaxProtocols; i++)
+		multiDecoders[i].bitsRemaining = 0;
+	codeProtocol = 0;
+	lirrClearEvents();
+	SREG = oldSREG;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// The protocol table
+// The built-in protocols are kept in flash in the order of the LIRR_INDEX_ constants, with RC5 and
+// RC6 in a table of their own. The protocols chosen by index are copied into RAM, so the decoders
+// read them as quickly as any other settings.
+// ----------------------------------------------------------------------------------------------------
+
+static const lirrPulseFractionSettings_t pfTable[] PROGMEM = {
+	PROTOCOL_NEC, PROTOCOL_JVC, PROTOCOL_RCA, PROTOCOL_SHARP, PROTOCOL_SAMSUNG, PROTOCOL_SIRC,
+	PROTOCOL_NEC_STD, PROTOCOL_JVC_STD, PROTOCOL_SAMSUNG_STD, PROTOCOL_SIRC_STD, PROTOCOL_SIRC15, PROTOCOL_SIRC20,
+#ifdef lirrWideCodes
+	PROTOCOL_KASEIKYO
+#endif
+};
+static const lirrBiPhaseSettings_t bpTable[] PROGMEM = {PROTOCOL_RC5, PROTOCOL_RC6_MODE0};
+static const uint8_t bpTableCount = sizeof(bpTable) / sizeof(bpTable[0]);
+
+// the settings' members are const, so they're copied into bytes instead (aligned for any board)
+union settingsCopy_t
+{
+	uint8_t bytes[sizeof(lirrPulseFractionSettings_t)]; // the larger of the two
+	uint32_t alignment;
+};
+static settingsCopy_t indexSettings; // the protocol chosen by lirrSetProtocol(protocolIndex)
+// the protocols chosen by lirrSetProtocol(protocolIndexes, count), in two sets, so that one can be
+// filled while the ISR decodes with the other
+static settingsCopy_t multiIndexSettings[2][lirrMaxProtocols];
+static const lirrPulseFractionSettings_t *multiIndexPF[2][lirrMaxProtocols];
+static const lirrBiPhaseSettings_t *multiIndexBP[2][lirrMaxProtocols];
+static uint8_t multiIndexSet = 0; // the set that was filled last
+
+// finds a protocol in the tables: one of pPF and pBP is set, or neither if the index isn't in them
+static inline void tableEntry(uint8_t protocolIndex, const lirrPulseFractionSettings_t *&pPF, const lirrBiPhaseSettings_t *&pBP)
+{
+	pPF = NULL;
+	pBP = NULL;
+	if (protocolIndex < LIRR_INDEX_RC5)
+		pPF = &pfTable[protocolIndex];
+	else if (protocolIndex < LIRR_INDEX_RC5 + bpTableCount)
+		pBP = &bpTable[protocolIndex - LIRR_INDEX_RC5];
+	else if (protocolIndex < lirrIndexCount)
+		pPF = &pfTable[protocolIndex - bpTableCount];
+}
+
+// the sensor isn't set up with an index that isn't in the table, since there's nothing to decode with
+bool lirrBegin(uint8_t pinInterrupt, uint8_t protocolIndex)
+{
+	if (!lirrSetProtocol(protocolIndex))
+		return false;
+	lirrInit(pinInterrupt);
+	return true;
+}
+
+bool lirrBegin(uint8_t pinInterrupt, const uint8_t protocolIndexes[], uint8_t count)
+{
+	bool allChosen = lirrSetProtocol(protocolIndexes, count);
+	lirrInit(pinInterrupt);
+	return allChosen;
+}
+
+bool lirrSetProtocol(uint8_t protocolIndex)
+{
+	const lirrPulseFractionSettings_t *pPF;
+	const lirrBiPhaseSettings_t *pBP;
+	tableEntry(protocolIndex, pPF, pBP);
+	
+	// the protocol being decoded is kept if the index isn't in the table
+	if (!pPF && !pBP)
+		return false;
+	
+	// the ISR may be decoding with the copy that's about to be replaced
+	uint8_t oldSREG = SREG;
+	cli();
+	if (pPF)
+	{
+		memcpy_P(indexSettings.bytes, pPF, sizeof(lirrPulseFractionSettings_t));
+		lirrSetProtocol(*(const lirrPulseFractionSettings_t *)indexSettings.bytes);
+	}
+	else if (pBP)
+	{
+		memcpy_P(indexSettings.bytes, pBP, sizeof(lirrBiPhaseSettings_t));
+		lirrSetProtocol(*(const lirrBiPhaseSettings_t *)indexSettings.bytes);
+	}
+	SREG = oldSREG;
+	return true;
+}
+
+bool lirrSetProtocol(const uint8_t protocolIndexes[], uint8_t count)
+{
+	// the ISR may be decoding with the set that was filled last, so the other one is filled (with
+	// interrupts on), and only the switch to it holds off the ISR
+	uint8_t set = multiIndexSet ^ 1;
+	uint8_t pfCount = 0, bpCount = 0;
+	settingsCopy_t *pCopy = multiIndexSettings[set];
+	
+	// the pulse distance/width protocols go first, as they do in the lists of settings
+	for (uint8_t pass = 0; pass < 2; pass++)
+	{
+		for (uint8_t i = 0; (i < count) && (pCopy < multiIndexSettings[set] + lirrMaxProtocols); i++)
+		{
+			const lirrPulseFractionSettings_t *pPF;
+			const lirrBiPhaseSettings_t *pBP;
+			tableEntry(protocolIndexes[i], pPF, pBP);
+			
+			// only a single protocol can have more than 32 bits (there's one wideIncoming)
+			if (pPF && (pgm_read_byte(&pPF->bits) > 32))
+				pPF = NULL;
+			if (pPF && (pass == 0))
+			{
+				memcpy_P(pCopy->bytes, pPF, sizeof(lirrPulseFractionSettings_t));
+				multiIndexPF[set][pfCount++] = (const lirrPulseFractionSettings_t *)(pCopy++)->bytes;
+			}
+			else if (pBP && (pass == 1))
+			{
+				memcpy_P(pCopy->bytes, pBP, sizeof(lirrBiPhaseSettings_t));
+				multiIndexBP[set][bpCount++] = (const lirrBiPhaseSettings_t *)(pCopy++)->bytes;
+			}
+		}
+	}
+	lirrSetProtocol(multiIndexPF[set], pfCount, multiIndexBP[set], bpCount);
+	multiIndexSet = set;
+	return (pfCount + bpCount) == count;
+}
+
+#endif
+
+#ifdef LIRR_RECEIVERS_SUPPORTED
+
+// ----------------------------------------------------------------------------------------------------
+// These functions add a receiver to the list that the ISR decodes
+// ----------------------------------------------------------------------------------------------------
+
+static void addReceiver(lirrReceiver_t &receiver, uint8_t pinInterrupt, const void *pSettings,
+	void (*pReceiverDecodeFunction)(lirrReceiver_t &receiver, bool pinState, lirrTime_t curTime))
+{
+	lirrInit(pinInterrupt);
+	
+	uint8_t oldSREG = SREG;
+	cli();
+	receiver.pDecodeFunction = pReceiverDecodeFunction;
+	receiver.pSettings = pSettings;
+	receiver.pinMask = digitalPinToBitMask(pinInterrupt);
+	receiver.decoder.bitsRemaining = 0;
+	receiver.remoteEvents.buttonState = BUTTON_NONE;
+	receiver.remoteEvents.buttonCode = 0;
+	
+	// only add it to the list once, in case lirrBegin() is called again to change the protocol
+	lirrReceiver_t *pReceiver = pReceivers;
+	while (pReceiver && (pReceiver != &receiver))
+		pReceiver = pReceiver->pNext;
+	if (!pReceiver)
+	{
+		receiver.pNext = pReceivers;
+		pReceivers = &receiver;
+	}
+	
+	pReceiverPort = portInputRegister(digitalPinToPort(pinInterrupt));
+	receiverPinLevels = *pReceiverPort;
+	
+	// the ISR passes on changes to any of the receivers' pins, and receiverDemux() sorts them out
+	pinMask = 0;
+	for (pReceiver = pReceivers; pReceiver; pReceiver = pReceiver->pNext)
+		pinMask |= pReceiver->pinMask;
+	lastPinLevel = *pPinPort & pinMask;
+	pDecodeFunction = receiverDemux;
+	SREG = oldSREG;
+}
+
+void lirrBegin(lirrReceiver_t &receiver, uint8_t pinInterrupt, const lirrPulseFractionSettings_t &remoteProtocol)
+{
+	addReceiver(receiver, pinInterrupt, &remoteProtocol, receiverPulseFractionDecode);
+}
+
+void lirrBegin(lirrReceiver_t &receiver, uint8_t pinInterrupt, const lirrBiPhaseSettings_t &remoteProtocol)
+{
+	addReceiver(receiver, pinInterrupt, &remoteProtocol, receiverBiPhaseDecode);
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------
+
+void lirrClearEvents(void)
+{
+    remoteEvents.buttonState = BUTTON_NONE;
+    remoteEvents.buttonCode = 0;
+#ifdef lirrQueueSize
+	queueTail = queueHead; // discard any queued frames
+#endif
+#ifdef lirrWideCodes
+	wideBits = 0;
+#endif
+}
+
+#ifdef lirrWideCodes
+
+// ----------------------------------------------------------------------------------------------------
+// Copies out the frame of the current button code, for protocols with more than 32 bits
+// ----------------------------------------------------------------------------------------------------
+
+uint8_t lirrGetWideCode(uint8_t code[lirrWideCodes])
+{
+	// the ISR replaces wideCode when a new button code is accepted
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t bits = wideBits;
+	for (uint8_t i = 0; i < lirrWideCodes; i++)
+		code[i] = wideCode[i];
+	SREG = oldSREG;
+	return bits;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Stops the interrupt that lirrBegin() set up, leaving the rest of the hardware alone
+// ----------------------------------------------------------------------------------------------------
+
+void lirrEnd(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+#ifdef lirrInputCapture
+	TIMSK1 &= ~(_BV(ICIE1) | _BV(TOIE1));
+#elif defined(lirrExternalInterrupt)
+	EIMSK &= ~_BV(INT0 + lirrExternalInterrupt);
+#elif defined(lirrExternalFeed)
+	// the edges that are still fed are decoded as usual, so stop calling lirrFeedEdge() first
+#else
+	// the pin change interrupt of the port is left on if other pins on the port still use it
+	volatile uint8_t *pPCMSK = digitalPinToPCMSK(sensorPin);
+	*pPCMSK &= ~(1 << digitalPinToPCMSKbit(sensorPin));
+	if (!*pPCMSK)
+		PCICR &= ~(1 << digitalPinToPCICRbit(sensorPin));
+#endif
+#ifdef lirrGateTime
+	gateStop();
+#endif
+	lirrClearEvents();
+#ifdef lirrEdgeBufferSize
+	edgeTail = edgeHead; // discard any edges that haven't been decoded
+#endif
+	SREG = oldSREG;
+}
+
+#ifdef lirrProfile
+
+// ----------------------------------------------------------------------------------------------------
+// Returns a copy of the ISR profile, or clears it
+// ----------------------------------------------------------------------------------------------------
+
+lirrProfile_t lirrGetProfile(void)
+{
+	lirrProfile_t profileCopy;
+	uint8_t oldSREG = SREG;
+	cli();
+	profileCopy = profile;
+	SREG = oldSREG;
+	return profileCopy;
+}
+
+void lirrClearProfile(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	memset(&profile, 0, sizeof(profile));
+	profile.minCycles = 0xFFFF;
+	SREG = oldSREG;
+}
+
+#endif
+
+#ifdef lirrStats
+
+// ----------------------------------------------------------------------------------------------------
+// Returns a copy of the statistics, or clears them
+// ----------------------------------------------------------------------------------------------------
+
+lirrStats_t lirrGetStats(void)
+{
+	lirrStats_t statsCopy;
+	uint8_t oldSREG = SREG;
+	cli();
+	statsCopy = stats;
+	SREG = oldSREG;
+	return statsCopy;
+}
+
+void lirrClearStats(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	memset(&stats, 0, sizeof(stats));
+	SREG = oldSREG;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// Returns the index of the protocol that sent the current button code
+// Only meaningful when several protocols were passed to lirrBegin()
+// ----------------------------------------------------------------------------------------------------
+
+uint8_t lirrGetProtocol(void)
+{
+	return codeProtocol;
+}
+
+#ifdef lirrQueueSize
+
+// ----------------------------------------------------------------------------------------------------
+// Takes the oldest frame out of the queue, bypassing the pressed/held/released state machine
+// Returns false if the queue is empty
+// ----------------------------------------------------------------------------------------------------
+
+bool lirrReadFrame(lirrFrame_t &frame)
+{
+	uint8_t tail = queueTail;
+	if (tail == queueHead)
+		return false;
+	lirrBarrier(); // the frame must not be read before it is published
+	frame = frameQueue[tail & (lirrQueueSize - 1)];
+	lirrBarrier(); // the frame must be read before its slot is released
+	queueTail = tail + 1;
+	return true;
+}
+
+// returns a pointer to the oldest frame in the queue without removing it, or NULL if it's empty
+static inline const lirrFrame_t *peekFrame(void)
+{
+	uint8_t tail = queueTail;
+	if (tail == queueHead)
+		return NULL;
+	lirrBarrier();
+	return &frameQueue[tail & (lirrQueueSize - 1)];
+}
+
+static inline void dropFrame(void)
+{
+	lirrBarrier();
+	queueTail++;
+}
+
+#endif
+
+#ifdef lirrEdgeBufferSize
+
+// ----------------------------------------------------------------------------------------------------
+// Runs the decoding function over the edges that the ISR has buffered
+// ----------------------------------------------------------------------------------------------------
+
+void lirrProcess(void)
+{
+	static lirrTime_t decodeTime = 0;
+	
+	// get the buffer's head along with the time of the edge at the head
+	// if the ISR runs part way through, the head will have changed, so try again
+	uint8_t head;
+	lirrTime_t headTime;
+	do
+	{
+		head = edgeHead;
+		headTime = lastEdgeTime;
+	} while (head != edgeHead);
+	
+	uint8_t tail = edgeTail;
+	if (tail == head)
+		return;
+	
+	do
+	{
+		lirrBarrier(); // the edge must not be read before it is published
+		uint16_t edge = edgeBuffer[tail & (lirrEdgeBufferSize - 1)];
+		lirrBarrier(); // the edge must be read before its slot is released
+		edgeTail = ++tail;
+		decodeTime += edge & 0xFFFE;
+		// a saturated gap that ends with the newest edge is lined up right away, so that the edge
+		// after it is timed from the right place (capture mode measures the gaps themselves)
+		if ((tail == head) && ((edge & 0xFFFE) == 0xFFFE))
+			decodeTime = headTime;
+		decodeEdge(edge & 1, decodeTime);
+	} while (tail != head);
+	
+	// long gaps between edges are saturated, so line up with the ISR's time again
+	decodeTime = headTime;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// These functions read what the ISR writes without disabling interrupts
+// The ISR changes eventSequence after each edge, so if it's the same before and after a copy,
+// the ISR didn't run part way through it and the copy is consistent
+// ----------------------------------------------------------------------------------------------------
+
+// gets the time of the last signal for the active code, and how long to wait for the next one
+// before reporting that the button has been released
+static inline void readLastSignal(const lirrDecoderState_t &state, const lirrTime_t &stateFrameTime,
+	const lirrTime_t &stateReleaseTime, lirrTime_t &lastSignalTime, lirrTime_t &timeout)
+{
+	uint8_t sequence;
+	do
+	{
+		sequence = eventSequence;
+		lirrBarrier();
+		timeout = stateReleaseTime;
+		lastSignalTime = timeout ? stateFrameTime : state.referenceTime;
+		lirrBarrier();
+	} while (sequence != eventSequence);
+	
+	// protocols without a releaseTime are held for as long as any edges keep arriving
+	if (!timeout)
+		timeout = repeatTime;
+}
+
+// the ISR only writes new codes into events while they are in the BUTTON_NONE state
+static inline remoteEvents_t readEvents(const remoteEvents_t &events)
+{
+	remoteEvents_t eventsCopy;
+	uint8_t sequence;
+	do
+	{
+		sequence = eventSequence;
+		lirrBarrier();
+		eventsCopy = events;
+		lirrBarrier();
+	} while (sequence != eventSequence);
+	return eventsCopy;
+}
+
+// returns the current time, in the same units as the edge times
+// interrupts are only disabled for as long as it takes to read Timer1
+static inline lirrTime_t readCurrentTime(void)
+{
+#if defined(lirrInputCapture) || defined(lirrTimerTicks)
+	uint8_t oldSREG = SREG;
+	cli();
+	lirrTime_t now = currentTime();
+	SREG = oldSREG;
+	return now;
+#else
+	return micros();
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+// This function captures available button codes and determines pressed, held, and released states
+// ----------------------------------------------------------------------------------------------------
+
+remoteEvents_t lirrGetEvents(void)
+{
+#ifdef lirrEdgeBufferSize
+	// decode any edges that have been received since the last call
+	lirrProcess();
+#endif
+
+	// get last time the active code was received, and the current time from the same clock
+	lirrTime_t lastSignalTime, timeout;
+	readLastSignal(decoder, frameTime, releaseTime, lastSignalTime, timeout);
+	lirrTime_t now = readCurrentTime();
+#ifdef lirrTimerTicks
+	remoteEvents.curTime = micros();
+#else
+	remoteEvents.curTime = now;
+#endif
+	
+	switch(remoteEvents.buttonState)
+	{
+		case BUTTON_PRESSED:
+			// if a button was previously pressed, change the state to held
+			remoteEvents.buttonState = BUTTON_HELD;
+			break;
+		case BUTTON_HELD:
+		{
+#ifdef lirrQueueSize
+			// frames that repeat the held button's code (and toggle bit) are discarded
+			// any other frame means that the held button was released, and is left for BUTTON_NONE
+			const lirrFrame_t *pFrame;
+			while ((pFrame = peekFrame()) != NULL)
+			{
+				if ((pFrame->code != remoteEvents.buttonCode) || (pFrame->toggle != lastFrameToggle)
+					|| ((lirrTime_t)(pFrame->time - lastFrameTime) > timeout))
+				{
+					remoteEvents.buttonState = BUTTON_RELEASED;
+					break;
+				}
+				lastFrameTime = pFrame->time;
+				dropFrame();
+			}
+#endif
+			// if a button has not been pressed in a while, set the released event
+			// and start reading new codes
+			if ((lirrTime_t)(now - lastSignalTime) > timeout)
+				remoteEvents.buttonState = BUTTON_RELEASED;
+			break;
+		}
+		case BUTTON_RELEASED:
+			// if a button was previously released, change the state to none
+			// the code must be cleared first, since the ISR can write a new one as soon as the state is none
+			remoteEvents.buttonCode = 0;
+			lirrBarrier();
+			remoteEvents.buttonState = BUTTON_NONE;
+			// yes, the lack of a break; is intentional
+		case BUTTON_NONE:
+			// once the state is changed to pressed below, the ISR leaves the code alone,
+			// so the rest of the events can be read without disabling interrupts
+#ifdef lirrQueueSize
+		{
+			lirrFrame_t frame;
+			if (lirrReadFrame(frame))
+			{
+				remoteEvents.buttonCode = frame.code;
+				remoteEvents.pressTime = frame.time;
+				remoteEvents.toggleState = !remoteEvents.toggleState;
+				lastFrameTime = frame.time;
+				lastFrameToggle = frame.toggle;
+				codeProtocol = frame.protocol;
+			}
+		}
+#endif
+			// fetch available code and do some final processing
+			if (remoteEvents.buttonCode)
+			{
+				remoteEvents.buttonState = BUTTON_PRESSED;
+#ifdef lirrTimerTicks
+				// the press was timestamped in timer ticks
+				remoteEvents.pressTime = ticksToMicros(remoteEvents.pressTime, now, remoteEvents.curTime);
+#endif
+			}
+			break;
+	}
+
+	return readEvents(remoteEvents);
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Calls the callback set by lirrOnEvent() each time the button state changes
+// Idle calls only check a flag: the ISR sets it when something is received, and it stays set
+// until the button is released, since lirrGetEvents() has to look for the release
+// ----------------------------------------------------------------------------------------------------
+
+void lirrOnEvent(lirrEventCallback_t pCallback)
+{
+	pEventCallback = pCallback;
+}
+
+void lirrService(void)
+{
+	if (!serviceNeeded)
+		return;
+	serviceNeeded = false; // cleared first, so that anything the ISR receives from now on sets it again
+	
+	static uint8_t lastState = BUTTON_NONE;
+	remoteEvents_t events = lirrGetEvents();
+	if ((events.buttonState != lastState) && (events.buttonState != BUTTON_NONE) && pEventCallback)
+		pEventCallback(events);
+	lastState = events.buttonState;
+	
+	if (events.buttonState != BUTTON_NONE)
+		serviceNeeded = true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Looks up the action for a button code with a binary search of a table in flash
+// The table must be sorted by code (a 45 button remote takes at most 6 comparisons)
+// ----------------------------------------------------------------------------------------------------
+
+uint8_t lirrGetAction(uint32_t buttonCode, const lirrAction_t *pActions, uint8_t actionCount)
+{
+	uint8_t low = 0;
+	uint8_t high = actionCount;
+	while (low < high)
+	{
+		uint8_t middle = low + ((high - low) >> 1);
+		uint32_t code = pgm_read_dword(&pActions[middle].code);
+		if (code < buttonCode)
+			low = middle + 1;
+		else if (code > buttonCode)
+			high = middle;
+		else
+			return pgm_read_byte(&pActions[middle].action);
+	}
+	return LIRR_NO_ACTION;
+}
+
+remoteEvents_t lirrGetEvents(uint8_t &action, const lirrAction_t *pActions, uint8_t actionCount)
+{
+	remoteEvents_t events = lirrGetEvents();
+	action = lirrGetAction(events.buttonCode, pActions, actionCount);
+	return events;
+}
 
 // ----------------------------------------------------------------------------------------------------
-// function for handling pulse width and pulse distance encoding
+// Gestures
+// Works from the button states that lirrGetEvents() already keeps, so each call only looks at the
+// time since one event. Times are the low 16 bits of millis(), which is plenty for up to 65 seconds.
 // ----------------------------------------------------------------------------------------------------
 
-static void pulseFractionDecode(bool pinState)
+static const uint8_t GESTURE_IDLE = 0;
+static const uint8_t GESTURE_DOWN = 1; // pressed (on its own, no long press or repeat has been sent yet)
+static const uint8_t GESTURE_WAITING = 2; // released after a short press, and waiting to see if it's pressed again
+static const uint8_t GESTURE_SECOND = 3; // pressed again, after LIRR_GESTURE_DOUBLE_PRESS
+// added to GESTURE_DOWN once each has been sent, since the long press can come before or after the first repeat
+static const uint8_t GESTURE_LONG_SENT = 0x10;
+static const uint8_t GESTURE_REPEATING = 0x20;
+static const uint8_t GESTURE_STATE = 0x0F; // the state without the above
+
+static inline uint8_t gesturePressed(lirrGesture_t &gesture, const remoteEvents_t &remoteEvents, const lirrGestureSettings_t &settings, uint16_t now)
 {
-	static uint8_t bitsRemaining = 0;
+	gesture.buttonCode = remoteEvents.buttonCode;
+	gesture.pressTime = gesture.eventTime = now;
+	gesture.repeatInterval = settings.repeatDelay;
+	gesture.state = GESTURE_DOWN;
+	
+	// without double presses, there's no need to wait for the release
+	return settings.doublePress ? LIRR_GESTURE_NONE : LIRR_GESTURE_PRESS;
+}
 
-	switch (pinState == pPFSettings->distanceMode)
+uint8_t lirrGetGesture(lirrGesture_t &gesture, const remoteEvents_t &remoteEvents, const lirrGestureSettings_t &settings)
+{
+	uint16_t now = millis();
+	
+	switch (remoteEvents.buttonState)
 	{
-		case true:
+		case BUTTON_PRESSED:
 		{
-			uint32_t curTime = micros();
-			uint32_t measuredTime = curTime - referenceTime;
-			referenceTime = curTime;
+			if (gesture.state != GESTURE_WAITING)
+				return gesturePressed(gesture, remoteEvents, settings, now);
 			
-			switch (bitsRemaining == 0)
+			// a second press of the same button in time makes a double press
+			if ((remoteEvents.buttonCode == gesture.buttonCode) && ((uint16_t)(now - gesture.eventTime) < settings.doublePress))
 			{
-				case false:
-				{
-					if ((measuredTime > pPFSettings->bitMin) && (measuredTime < pPFSettings->bitMax))
-					{
-						bitsRemaining--;
-
-						if (measuredTime > pPFSettings->bitSep)
-							incomingCode |= (1UL << bitsRemaining);
-						
-						if (bitsRemaining == 0)
-						{
-							if (remoteEvents.buttonState == BUTTON_NONE)
-							{
-								remoteEvents.buttonCode = incomingCode;
-								remoteEvents.pressTime = curTime;
-								remoteEvents.toggleState = !remoteEvents.toggleState;
-							}
-						}
-						break;
-					}
-					else
-						bitsRemaining = 0; // if unexpected timing occurs, immediately restart
-				}
-				case true:
+				gesture.state = GESTURE_SECOND;
+				return LIRR_GESTURE_DOUBLE_PRESS;
+			}
+			
+			// otherwise the press that was waiting is sent first (with its buttonCode), and the new
+			// one is picked up on the next call
+			gesture.state = GESTURE_IDLE;
+			return LIRR_GESTURE_PRESS;
+		}
+		case BUTTON_HELD:
+		{
+			if (gesture.state == GESTURE_IDLE)
+				return gesturePressed(gesture, remoteEvents, settings, now);
+			if ((gesture.state & GESTURE_STATE) != GESTURE_DOWN)
+				break;
+			
+			if (!(gesture.state & GESTURE_LONG_SENT) && settings.longPress && ((uint16_t)(now - gesture.pressTime) >= settings.longPress))
+			{
+				gesture.state |= GESTURE_LONG_SENT;
+				return LIRR_GESTURE_LONG_PRESS;
+			}
+			
+			if (settings.repeatDelay && ((uint16_t)(now - gesture.eventTime) >= gesture.repeatInterval))
+			{
+				// stepping from the last repeat keeps the rate steady however often this is called
+				gesture.eventTime += gesture.repeatInterval;
+				if (!(gesture.state & GESTURE_REPEATING))
+					gesture.repeatInterval = settings.repeatFirst;
+				else
 				{
-					if (
-						((measuredTime < pPFSettings->startMax)
-							&& (measuredTime > pPFSettings->startMin))
-						|| (pPFSettings->startMax == 0)
-					)
-					{
-						bitsRemaining = pPFSettings->bits;
-						incomingCode = 0;
-					}
+					uint16_t interval = gesture.repeatInterval - (((uint32_t)gesture.repeatInterval * settings.repeatSpeedUp) >> 8);
+					gesture.repeatInterval = (interval < settings.repeatFastest) ? settings.repeatFastest : interval;
 				}
+				gesture.state |= GESTURE_REPEATING;
+				return LIRR_GESTURE_REPEAT;
 			}
 			break;
 		}
-		case false:
+		case BUTTON_RELEASED:
+		{
+			// a short press might be the first of a double press
+			if ((gesture.state == GESTURE_DOWN) && settings.doublePress)
+			{
+				gesture.state = GESTURE_WAITING;
+				gesture.eventTime = now;
+			}
+			else
+				gesture.state = GESTURE_IDLE;
+			break;
+		}
+		default:
 		{
-			if (!pPFSettings->distanceMode)
-				referenceTime = micros();
+			if ((gesture.state == GESTURE_WAITING) && ((uint16_t)(now - gesture.eventTime) >= settings.doublePress))
+			{
+				gesture.state = GESTURE_IDLE;
+				return LIRR_GESTURE_PRESS;
+			}
 		}
 	}
+	return LIRR_GESTURE_NONE;
 }
 
+#ifdef LIRR_RECEIVERS_SUPPORTED
+
 // ----------------------------------------------------------------------------------------------------
-// function for handling bi-phase encoding
+// Same as above, for one of several receivers
 // ----------------------------------------------------------------------------------------------------
 
-static void biPhaseDecode(bool pinState)
+void lirrClearEvents(lirrReceiver_t &receiver)
 {
+    receiver.remoteEvents.buttonState = BUTTON_NONE;
+    receiver.remoteEvents.buttonCode = 0;
+}
 
-	uint32_t curTime = micros();
-
-	static uint8_t bitsRemaining = 0;
-	static const uint16_t * bitTime;
-
-	switch (bitsRemaining == 0)
+remoteEvents_t lirrGetEvents(lirrReceiver_t &receiver)
+{
+	remoteEvents_t &events = receiver.remoteEvents;
+	
+	lirrTime_t lastSignalTime, timeout;
+	readLastSignal(receiver.decoder, receiver.frameTime, receiver.releaseTime, lastSignalTime, timeout);
+	lirrTime_t now = readCurrentTime();
+#ifdef lirrTimerTicks
+	events.curTime = micros();
+#else
+	events.curTime = now;
+#endif
+	
+	switch(events.buttonState)
 	{
-		case false:
-		{
-			uint32_t measuredTime = curTime - referenceTime;
-
-			if (measuredTime < bitTime[1])
-			{
-				if (measuredTime > bitTime[0])
-				{
-					// we're at the middle of a bit
-					referenceTime = curTime;
-					
-					bitsRemaining--;
-					if (pinState == pBPSettings->aceRising)
-					{
-						if (bitsRemaining != pBPSettings->togglePos)
-							incomingCode += (1UL << bitsRemaining);
-					}
-					
-					// if we've received all the bits, indicate that the code is ready
-					// otherwise, determine the time until the next bit
-					if (bitsRemaining == 0)
-					{
-						if (remoteEvents.buttonState == BUTTON_NONE)
-						{
-							remoteEvents.buttonCode = incomingCode;
-							remoteEvents.pressTime = curTime;
-							remoteEvents.toggleState = !remoteEvents.toggleState;
-						}
-					}
-					else if ((bitsRemaining != (pBPSettings->togglePos+1)) && (bitsRemaining != pBPSettings->togglePos))
-						bitTime = pBPSettings->bitTime;
-					else
-						bitTime = pBPSettings->toggleTime;
-					
-				}
-				break;
-			}
-			else
-				bitsRemaining = 0; // if unexpected timing occurs, immediately restart
-		}		
-		case true:
-		{
-			// wait for a rising edge
-			if (pinState)
+		case BUTTON_PRESSED:
+			events.buttonState = BUTTON_HELD;
+			break;
+		case BUTTON_HELD:
+			if ((lirrTime_t)(now - lastSignalTime) > timeout)
+				events.buttonState = BUTTON_RELEASED;
+			break;
+		case BUTTON_RELEASED:
+			events.buttonCode = 0;
+			lirrBarrier();
+			events.buttonState = BUTTON_NONE;
+			// yes, the lack of a break; is intentional
+		case BUTTON_NONE:
+			if (events.buttonCode)
 			{
-				bitsRemaining = pBPSettings->bits;
-				incomingCode = 0;
-				bitTime = pBPSettings->startTime;
-				referenceTime = curTime;
+				events.buttonState = BUTTON_PRESSED;
+#ifdef lirrTimerTicks
+				events.pressTime = ticksToMicros(events.pressTime, now, events.curTime);
+#endif
 			}
-		}
+			break;
 	}
+	
+	return readEvents(events);
 }
 
+#endif
+
 // ----------------------------------------------------------------------------------------------------
-// ISR that calls the needed decoding function
+// Puts the MCU to sleep until the next interrupt
+// Standby is used while nothing is being received, since a pin change wakes the MCU from it within
+// a few cycles. Power-down would wait for the crystal to start, which skews the first edge's time.
+// Idle is used while a frame or button is active, since the timers must keep running to time it.
 // ----------------------------------------------------------------------------------------------------
 
-ISR(PCINT2_vect)
+// returns true if a decoder or its events still need the timers
+static inline bool signalActive(const lirrDecoderState_t &state, const remoteEvents_t &events, lirrTime_t now)
 {
-#ifdef lirrTest
-	uint32_t startTime = micros();
+	return (events.buttonState != BUTTON_NONE) || events.buttonCode
+		|| ((lirrTime_t)(now - state.referenceTime) <= repeatTime);
+}
+
+void lirrSleep(void)
+{
+	cli();
+	
+#ifdef lirrQueueSize
+	// don't sleep on frames that lirrGetEvents() hasn't seen yet
+	if (queueHead != queueTail)
+	{
+		sei();
+		return;
+	}
+#endif
+#ifdef lirrEdgeBufferSize
+	// or on edges that haven't been decoded yet
+	if (edgeHead != edgeTail)
+	{
+		sei();
+		return;
+	}
+#endif
+	
+#if defined(lirrInputCapture) || defined(lirrExternalInterrupt) || defined(lirrExternalFeed)
+	// the capture unit and INT0/INT1 edge detection need the I/O clock, which stops in standby,
+	// and so might whatever feeds the edges
+	set_sleep_mode(SLEEP_MODE_IDLE);
+#else
+	lirrTime_t now = currentTime();
+	bool active = signalActive(decoder, remoteEvents, now);
+#ifdef LIRR_RECEIVERS_SUPPORTED
+	for (lirrReceiver_t *pReceiver = pReceivers; pReceiver; pReceiver = pReceiver->pNext)
+		active = active || signalActive(pReceiver->decoder, pReceiver->remoteEvents, now);
 #endif
-	static bool pinState = false;
-	pinState = !pinState;
-	pDecodeFunction(pinState);
-#ifdef lirrTest
-	decodeTime += (micros() - startTime);
-	decodeCount++;
+#ifdef lirrGateTime
+	// Timer0 stops in standby, and the gate needs it to turn the sensor's interrupt back on
+	active = active || gateCount;
 #endif
+	set_sleep_mode(active ? SLEEP_MODE_IDLE : SLEEP_MODE_STANDBY);
+#endif
+	
+	// interrupts must be enabled right before sleeping, so that one that arrives after the
+	// checks above still wakes the MCU (the instruction after sei always runs first)
+	sleep_enable();
+#ifdef sleep_bod_disable
+	sleep_bod_disable();
+#endif
+	sei();
+	sleep_cpu();
+	sleep_disable();
 }
 
+#ifdef LIRR_LEARNING_SUPPORTED
+
 // ----------------------------------------------------------------------------------------------------
-// Sets up the pin change interrupt
+// Learning mode
+// The decoding function below records the durations of each frame, and lirrLearn() works out
+// the encoding and timing of the frame once it's over. Everything is in microseconds here.
 // ----------------------------------------------------------------------------------------------------
 
-static inline void lirrInit(uint8_t pinInterrupt)
+static const uint8_t learnMaxDurations = 100; // a NEC frame has 67
+static const lirrTime_t learnFrameGap = LIRR_US(8000); // longer than any space within a frame
+
+static const uint8_t LEARN_WAITING = 0; // the next mark starts a frame
+static const uint8_t LEARN_RECORDING = 1;
+static const uint8_t LEARN_READY = 2; // lirrLearn() is looking at the frame, so it mustn't be changed
+static const uint8_t LEARN_SKIPPING = 3; // the frame was too long, so wait for a long space
+
+static uint16_t learnDurations[learnMaxDurations]; // alternating mark and space, starting with a mark
+static volatile uint8_t learnCount;
+static volatile uint8_t learnState;
+static volatile lirrTime_t learnEdgeTime;
+
+static void learnDecode(bool pinState, lirrTime_t curTime)
 {
-	// pull sensor pin high
-	pinMode(pinInterrupt, INPUT_PULLUP); 
-	
-	// Set up a pin change interrupt
-	// Need to put the sensor on one of the digital pins D0...D7
-    *digitalPinToPCMSK(pinInterrupt) |= (1 << digitalPinToPCMSKbit(pinInterrupt));  // enable the pin in the PCI mask
-	uint8_t PCICRBitMask = 1 << digitalPinToPCICRbit(pinInterrupt);
-    PCIFR |= PCICRBitMask; // clear interrupt
-    PCICR |= PCICRBitMask; // enable PCI for the port the pin is on
+	lirrTime_t duration = curTime - learnEdgeTime;
+	learnEdgeTime = curTime;
 	
-#ifdef lirrTest
-	Serial.begin(9600);
+	switch (learnState)
+	{
+		case LEARN_READY:
+			return;
+		case LEARN_RECORDING:
+			if (!pinState || (duration <= learnFrameGap))
+			{
+				if (learnCount < learnMaxDurations)
+#ifdef lirrTimerTicks
+					learnDurations[learnCount++] = duration;
+#else
+					learnDurations[learnCount++] = (duration > 0xFFFF) ? 0xFFFF : duration;
 #endif
+				else
+					learnState = LEARN_SKIPPING;
+				return;
+			}
+			break;
+		case LEARN_SKIPPING:
+			if (duration <= learnFrameGap)
+				return;
+	}
+	
+	// a mark starts a frame
+	if (pinState)
+	{
+		learnCount = 0;
+		learnState = LEARN_RECORDING;
+	}
 }
 
-// ----------------------------------------------------------------------------------------------------
-// These functions set up pointers to the protocol settings and decoding function
-// And call the initialization function above
-// Having overloaded lirrBegin() functions for each decoding function is what allows the
-// unused decoding functions to be optimized out.
-//
-// The pointer to the protocol struct is typecast to a pointer to its first member (this is legal)
-// and it is also legal to go back again (the reverse typecast occurs in the decoding functions)
-// this library exploits this to acchieve polymorphism-like behavior with POD structs
-// ----------------------------------------------------------------------------------------------------
+// the margin added to either side of each learned window
+static inline uint16_t learnMargin(uint16_t us)
+{
+	return 50 + (us >> 5);
+}
 
-void lirrBegin(uint8_t pinInterrupt, const lirrPulseFractionSettings_t &remoteProtocol)
+static inline void learnWindow(uint16_t window[2], uint16_t us)
 {
-	pPFSettings = &remoteProtocol;
-	pDecodeFunction = pulseFractionDecode;
-	lirrInit(pinInterrupt);
+	if (us < window[0])
+		window[0] = us;
+	if (us > window[1])
+		window[1] = us;
 }
 
-void lirrBegin(uint8_t pinInterrupt, const lirrBiPhaseSettings_t &remoteProtocol)
+// works out the encoding, bits and timing of the frame in learnDurations
+// returns false if it isn't a frame that can be decoded, or doesn't match the frames learned so far
+static bool learnFrame(lirrLearned_t &learned, uint8_t count)
 {
-	pBPSettings = &remoteProtocol;
-	pDecodeFunction = biPhaseDecode;
+	uint16_t *pDurations = learnDurations;
+	
+	// a frame ends with a mark, and anything shorter is eg, a NEC repeat frame
+	if ((count < 7) || !(count & 1))
+		return false;
+	
+#ifdef lirrTimerTicks
+	for (uint8_t i = 0; i < count; i++)
+	{
+		uint32_t us = (uint32_t)pDurations[i] * 64000UL / (F_CPU / 1000UL);
+		pDurations[i] = (us > 0xFFFF) ? 0xFFFF : us;
+	}
+#endif
+	
+	// the lengths of the marks and spaces after the first of each (which may be a start burst)
+	uint16_t markMin = 0xFFFF, markMax = 0, spaceMin = 0xFFFF, spaceMax = 0;
+	for (uint8_t i = 2; i < count; i++)
+	{
+		if (i & 1)
+		{
+			if (pDurations[i] < spaceMin)
+				spaceMin = pDurations[i];
+			if (pDurations[i] > spaceMax)
+				spaceMax = pDurations[i];
+		}
+		else
+		{
+			if (pDurations[i] < markMin)
+				markMin = pDurations[i];
+			if (pDurations[i] > markMax)
+				markMax = pDurations[i];
+		}
+	}
+	
+	// pulse distance encoding only varies the spaces, pulse width only the marks, and bi-phase both
+	// if neither varies, every bit is the same, and there's no telling them apart
+	bool marksVary = (markMax > markMin + (markMin >> 1));
+	bool spacesVary = (spaceMax > spaceMin + (spaceMin >> 1));
+	uint8_t encoding;
+	if (spacesVary && !marksVary)
+		encoding = LIRR_LEARN_DISTANCE;
+	else if (marksVary && !spacesVary)
+		encoding = LIRR_LEARN_WIDTH;
+	else if (marksVary && spacesVary)
+		encoding = LIRR_LEARN_BI_PHASE;
+	else
+		return false;
+	
+	uint8_t bits = 0;
+	uint32_t code = 0;
+	uint16_t start = 0;
+	uint16_t bitTimes[learnMaxDurations / 2 + 1];
+	
+	switch (encoding)
+	{
+		case LIRR_LEARN_DISTANCE:
+		{
+			// the time from the start of one mark to the start of the next is measured
+			uint8_t first = 0;
+			if (pDurations[0] > (markMax << 1))
+			{
+				start = pDurations[0] + pDurations[1];
+				first = 2;
+			}
+			for (uint8_t i = first; i + 1 < count; i += 2)
+				bitTimes[bits++] = pDurations[i] + pDurations[i + 1];
+			break;
+		}
+		case LIRR_LEARN_WIDTH:
+		{
+			// the length of each mark is measured
+			uint8_t first = 0;
+			if (pDurations[0] > markMax + (markMax >> 1))
+			{
+				start = pDurations[0];
+				first = 2;
+			}
+			for (uint8_t i = first; i < count; i += 2)
+				bitTimes[bits++] = pDurations[i];
+			break;
+		}
+		case LIRR_LEARN_BI_PHASE:
+		{
+			// every duration is half a bit or a whole bit (a start burst isn't supported)
+			uint16_t halfBit = 0xFFFF;
+			for (uint8_t i = 0; i < count; i++)
+				if (pDurations[i] < halfBit)
+					halfBit = pDurations[i];
+			
+			// the first mark starts in the middle of a bit, and each edge that comes more than 1.5 half
+			// bits after the middle of the last bit is the middle of the next one
+			uint16_t sinceMiddle = 0;
+			for (uint8_t i = 0; i < count; i++)
+			{
+				sinceMiddle += pDurations[i];
+				if (sinceMiddle > halfBit + (halfBit >> 1))
+				{
+					if ((sinceMiddle > (halfBit << 1) + (halfBit >> 1)) || (bits == 32))
+						return false;
+					// the edge after an odd numbered duration is the start of a mark
+					code = (code << 1) | (i & 1);
+					bitTimes[bits++] = sinceMiddle;
+					sinceMiddle = 0;
+				}
+			}
+			break;
+		}
+	}
+	
+	if ((bits < 4) || (bits > 32))
+		return false;
+	if (learned.frames && ((encoding != learned.encoding) || (bits != learned.bits) || ((start != 0) != (learned.start[1] != 0))))
+		return false;
+	
+	if (!learned.frames)
+	{
+		learned.encoding = encoding;
+		learned.bits = bits;
+		learned.start[0] = learned.bitShort[0] = learned.bitLong[0] = learned.shortestMark = 0xFFFF;
+		learned.start[1] = learned.bitShort[1] = learned.bitLong[1] = 0;
+		learned.codeChanges = 0;
+	}
+	
+	if (encoding == LIRR_LEARN_BI_PHASE)
+	{
+		for (uint8_t i = 0; i < bits; i++)
+			learnWindow(learned.bitShort, bitTimes[i]);
+	}
+	else
+	{
+		// split the bit times into zeros and ones
+		uint16_t timeMin = 0xFFFF, timeMax = 0;
+		for (uint8_t i = 0; i < bits; i++)
+		{
+			if (bitTimes[i] < timeMin)
+				timeMin = bitTimes[i];
+			if (bitTimes[i] > timeMax)
+				timeMax = bitTimes[i];
+		}
+		uint16_t bitSep = (timeMin + timeMax) >> 1;
+		for (uint8_t i = 0; i < bits; i++)
+		{
+			bool one = bitTimes[i] > bitSep;
+			code = (code << 1) | one;
+			learnWindow(one ? learned.bitLong : learned.bitShort, bitTimes[i]);
+		}
+		if (start)
+			learnWindow(learned.start, start);
+		if (markMin < learned.shortestMark)
+			learned.shortestMark = markMin;
+	}
+	
+	if (learned.frames)
+		learned.codeChanges |= code ^ learned.code;
+	learned.code = code;
+	if (learned.frames < 255)
+		learned.frames++;
+	return true;
+}
+
+void lirrBeginLearning(uint8_t pinInterrupt, lirrLearned_t &learned)
+{
+	learned.encoding = LIRR_LEARN_NONE;
+	learned.frames = 0;
+	learnState = LEARN_WAITING;
+	pDecodeFunction = learnDecode;
 	lirrInit(pinInterrupt);
 }
 
+bool lirrLearn(lirrLearned_t &learned)
+{
+#ifdef lirrEdgeBufferSize
+	lirrProcess();
+#endif
+	
+	// a frame is over once nothing has arrived for learnFrameGap
+	uint8_t oldSREG = SREG;
+	cli();
+	bool ready = (learnState == LEARN_RECORDING) && ((lirrTime_t)(currentTime() - learnEdgeTime) > learnFrameGap);
+	if (ready)
+		learnState = LEARN_READY;
+	SREG = oldSREG;
+	
+	if (!ready)
+		return false;
+	
+	bool learnt = learnFrame(learned, learnCount);
+	learnState = LEARN_WAITING;
+	return learnt;
+}
+
 // ----------------------------------------------------------------------------------------------------
+// These functions turn what has been learned into protocol settings, with windows a little wider
+// than the timings that were measured
 // ----------------------------------------------------------------------------------------------------
 
-void lirrClearEvents(void)
+lirrPulseFractionSettings_t lirrLearnedPulseFraction(const lirrLearned_t &learned)
 {
-    remoteEvents.buttonState = BUTTON_NONE;
-    remoteEvents.buttonCode = 0;
+	uint16_t startMin = 0, startMax = 0;
+	if (learned.start[1])
+	{
+		startMin = learned.start[0] - learnMargin(learned.start[0]);
+		startMax = learned.start[1] + learnMargin(learned.start[1]);
+	}
+	uint16_t bitMin = learned.bitShort[0] - learnMargin(learned.bitShort[0]);
+	uint16_t bitSep = (learned.bitShort[1] + learned.bitLong[0]) >> 1;
+	uint16_t bitMax = learned.bitLong[1] + learnMargin(learned.bitLong[1]);
+	
+	const lirrPulseFractionSettings_t settings = {
+		learned.bits, learned.encoding == LIRR_LEARN_DISTANCE,
+		(uint16_t)LIRR_US(startMin), (uint16_t)LIRR_US(startMax),
+		(uint16_t)LIRR_US(bitMin), (uint16_t)LIRR_US(bitSep), (uint16_t)LIRR_US(bitMax),
+		0, 0, 0, (uint16_t)LIRR_US(learned.shortestMark / 3), 0, 0
+	};
+	return settings;
+}
+
+lirrBiPhaseSettings_t lirrLearnedBiPhase(const lirrLearned_t &learned)
+{
+	uint16_t bitMin = LIRR_US(learned.bitShort[0] - learnMargin(learned.bitShort[0]));
+	uint16_t bitMax = LIRR_US(learned.bitShort[1] + learnMargin(learned.bitShort[1]));
+	
+	// a bit that changed between frames of the same button is a toggle bit
+	uint8_t togglePos = learned.bits; // none
+	uint32_t changes = learned.codeChanges;
+	if (changes && !(changes & (changes - 1)))
+		for (togglePos = 0; !(changes & 1); changes >>= 1)
+			togglePos++;
+	
+	const lirrBiPhaseSettings_t settings = {learned.bits, true, {bitMin, bitMax}, {bitMin, bitMax}, {bitMin, bitMax}, togglePos, 0};
+	return settings;
 }
 
+#endif
+
+#ifndef lirrStaticProtocol
+
 // ----------------------------------------------------------------------------------------------------
-// This function captures available button codes and determines pressed, held, and released states
+// Capture mode
+// The decoding function below only buffers the duration of each mark and space, and lirrCapture()
+// sends them out in packets. Each duration is in microseconds with the least significant bit
+// replaced by the level (1 for a mark), which loses nothing since micros() counts in steps of 4us
+// (at 16MHz). Durations of 65534us or more are sent as 0xFFFE (or 0xFFFF for a mark), followed by
+// an entry with the duration in units of 1024us (0xFFFF if it's even longer).
+//
+// Packet: 0xA5, count | 0x80 if edges were lost since the last packet, count durations (little endian),
+// and a checksum that makes the sum of all of the bytes after the 0xA5 a multiple of 256.
 // ----------------------------------------------------------------------------------------------------
 
-remoteEvents_t lirrGetEvents(void)
+#if (lirrCaptureBufferSize & (lirrCaptureBufferSize - 1)) || (lirrCaptureBufferSize > 128)
+#error "lirrCaptureBufferSize must be a power of two, and no more than 128"
+#endif
+
+static const uint8_t captureSync = 0xA5;
+static const uint8_t captureLostFlag = 0x80;
+static const uint16_t captureLongEntry = 0xFFFE; // a long space (or mark, with bit 0 set), the next entry is its length
+static const uint8_t captureMaxDurations = 24; // small enough for a packet to fit in the Serial transmit buffer
+static const lirrTime_t captureFlushTime = LIRR_US(8000); // send what's buffered once nothing has arrived for this long
+
+// single producer (ISR), single consumer (lirrCapture) ring buffer, like the edge buffer
+static uint16_t captureBuffer[lirrCaptureBufferSize];
+static volatile uint8_t captureHead; // only written by the ISR
+static volatile uint8_t captureTail; // only written by the main loop
+static volatile bool captureLost; // set by the ISR when the buffer is full, cleared by lirrCapture()
+static volatile lirrTime_t captureEdgeTime;
+
+static void captureDecode(bool pinState, lirrTime_t curTime)
+{
+	lirrTime_t duration = curTime - captureEdgeTime;
+	captureEdgeTime = curTime;
+#ifdef lirrTimerTicks
+	uint32_t us = (uint32_t)duration * (64000000UL / F_CPU);
+#else
+	uint32_t us = duration;
+#endif
+	
+	// the mark or space that this edge ended is the opposite of the new level
+	bool isLong = (us >= captureLongEntry);
+	uint16_t entry = isLong ? captureLongEntry : ((uint16_t)us & ~1);
+	if (!pinState)
+		entry |= 1;
+	
+	// a long duration takes two entries, which are both stored or both lost
+	uint8_t head = captureHead;
+	uint8_t needed = isLong ? 2 : 1;
+	if ((uint8_t)(head - captureTail) <= (uint8_t)(lirrCaptureBufferSize - needed))
+	{
+		captureBuffer[head & (lirrCaptureBufferSize - 1)] = entry;
+		if (isLong)
+			captureBuffer[(uint8_t)(head + 1) & (lirrCaptureBufferSize - 1)] = ((us >> 10) < 0xFFFF) ? (us >> 10) : 0xFFFF;
+		lirrBarrier(); // the entries must be written before they are published
+		captureHead = head + needed;
+	}
+	else
+		captureLost = true;
+}
+
+void lirrBeginCapture(uint8_t pinInterrupt)
 {
+	captureTail = captureHead;
+	captureLost = false;
+	captureEdgeTime = currentTime();
+	pDecodeFunction = captureDecode;
+	lirrInit(pinInterrupt);
+}
 
-	// get last time a bit was received
-	// need to temporarily disable global interrupt bit
-	// in order to get atomic access to referenceTime
-	uint32_t lastSignalTime;
+void lirrCapture(Print &out)
+{
+#ifdef lirrEdgeBufferSize
+	lirrProcess();
+#endif
+	
+	uint8_t tail = captureTail;
+	uint8_t count = captureHead - tail;
+	if (!count)
+		return;
+	
+	// wait for a full packet, unless the signal has gone quiet
+	if (count < captureMaxDurations)
+	{
+		uint8_t oldSREG = SREG;
+		cli();
+		bool quiet = (lirrTime_t)(currentTime() - captureEdgeTime) > captureFlushTime;
+		SREG = oldSREG;
+		if (!quiet)
+			return;
+	}
+	else
+		count = captureMaxDurations;
+	
 	uint8_t oldSREG = SREG;
 	cli();
-	lastSignalTime = referenceTime;
+	bool lost = captureLost;
+	captureLost = false;
 	SREG = oldSREG;
 	
-	// get current time
-	remoteEvents.curTime = micros();
-	
-	switch(remoteEvents.buttonState)
+	uint8_t packet[captureMaxDurations * 2 + 3];
+	uint8_t length = 0;
+	packet[length++] = captureSync;
+	packet[length++] = count | (lost ? captureLostFlag : 0);
+	lirrBarrier(); // the entries must not be read before they are published
+	for (uint8_t i = 0; i < count; i++)
 	{
-		case BUTTON_PRESSED:
-			// if a button was previously pressed, change the state to held
-			remoteEvents.buttonState = BUTTON_HELD;
-			break;
-		case BUTTON_HELD:
-		{
-			// if a button has not been pressed in a while, set the released event
-			// and start reading new codes
-			if ((remoteEvents.curTime - lastSignalTime) > repeatInt)
-				remoteEvents.buttonState = BUTTON_RELEASED;
-			break;
-		}
-		case BUTTON_RELEASED:
-			// if a button was previously released, change the state to none
-			remoteEvents.buttonState = BUTTON_NONE;
-			remoteEvents.buttonCode = 0;
-			// yes, the lack of a break; is intentional
-		case BUTTON_NONE:
-			// fetch available code and do some final processing
-			if (remoteEvents.buttonCode) {
-				remoteEvents.buttonState = BUTTON_PRESSED;
-#ifdef lirrTest
-				Serial.print("T(ISR): ");
-				Serial.print((float)decodeTime / decodeCount);
-				Serial.println("us");
-#endif
-			}
-			break;
+		uint16_t entry = captureBuffer[(uint8_t)(tail + i) & (lirrCaptureBufferSize - 1)];
+		packet[length++] = entry;
+		packet[length++] = entry >> 8;
 	}
-
-	return remoteEvents;
+	lirrBarrier(); // the entries must be read before they are handed back to the ISR
+	captureTail = tail + count;
 	
+	uint8_t sum = 0;
+	for (uint8_t i = 1; i < length; i++)
+		sum += packet[i];
+	packet[length++] = -sum;
+	out.write(packet, length);
 }
+
+#endif
@@ -7,19 +7,21 @@ License: GNU Lesser General Public License (LGPL) V2.1
 
 What it does:
 * Gives you a unique 32 bit number for each button.
-* Supports most of the common protocols, including NEC, Sony SIRC (12 bit), and RC5.
+* Supports most of the common protocols, including NEC, Sony SIRC (12, 15 and 20 bit), and RC5.
+* Can decode frames longer than 32 bits, such as Panasonic/Kaseikyo and air conditioner remotes (see lirrWideCodes).
 * Determines if a button has just been pressed, if it's being held down, and if it's just been released.
 * Gives you a time stamp of when the button was first pressed (good for "long pressed" events).
-* Can work with your sensor attached to any of digital pins 0 through 7 (minor software adjustment will permit attachment to any digital pin).
+* Can work with your sensor attached to any of digital pins 0 through 7 (a setting in lightIRRecv.h will permit attachment to other pins, or the use of INT0/INT1).
 * Allows you to specify your own protocols, provided that they use an existing protocol decoding function.
+* Can decode several protocols at the same time, and tell you which one was received.
+* Can decode several sensors at the same time, each with its own protocol.
 
 Limitations:
-* It doesn't auto-detect your remote's protocol.
+* It doesn't remember your remote's protocol.
 	* But you can use the "remoteTest" example sketch to figure out your remote's protocol.
-* It interprets all signals as being most significant bit first.
+* Unless you use the _STD protocol constants, it interprets all signals as being most significant bit first.
 	* So the button codes from this library will often differ from the official values.
-* It doesn't split the address code from the command code - they are combined together.
-* It doesn't split inverted verification codes from the non-inverted codes - they are combined together.
+	* The _STD constants split the address from the command, and check the inverted verification codes.
 
 */
 #ifndef lightIRRecv_H
@@ -27,7 +29,97 @@ Limitations:
 
 #include <Arduino.h>
 
-//#define lirrTest
+// Uncomment to measure how many CPU cycles the ISR takes (see lirrGetProfile)
+// Uses Timer1 to count cycles, so Timer1 can't be used for anything else
+//#define lirrProfile
+
+// Uncomment to count the edges, frames and rejected frames that the decoders see (see lirrGetStats)
+// Uses 16 bytes of RAM, and adds a few cycles to the ISR.
+//#define lirrStats
+
+// Uncomment to timestamp edges using the Timer1 input capture unit instead of a pin change interrupt.
+// Edge times are latched by the hardware, so they aren't skewed by interrupt latency, and the ISR
+// doesn't need to call micros(). The sensor must be attached to the ICP1 pin (D8 on the Uno/Nano),
+// and Timer1 can't be used for anything else (eg, the Servo library, or PWM on pins 9 and 10).
+// Note that pressTime is then measured by Timer1, so compare it against curTime instead of micros().
+//#define lirrInputCapture
+
+// Uncomment to time edges with Timer1 (a prescaler of 64, so 4us per tick at 16MHz) instead of
+// micros(). Edge times are then 16 bit timer counts, which keeps 32 bit math out of the ISR and the
+// decoding functions. Timer1 can't be used for anything else. The timing values in the protocol
+// settings are compiled in as ticks, so wrap the timing values of your own protocols in LIRR_US().
+// Tick counts wrap around after 262ms (at 16MHz), so call lirrGetEvents() at least every 250ms.
+//#define lirrTimerTicks
+
+// The pin change interrupt vector to use. The sensor must be on one of the pins that belong to it.
+// On the Uno/Nano, PCINT2_vect is D0...D7, PCINT0_vect is D8...D13, and PCINT1_vect is A0...A5.
+#ifndef lirrPinChangeVector
+#define lirrPinChangeVector PCINT2_vect
+#endif
+
+// Uncomment to use an external interrupt instead of a pin change interrupt: 0 for INT0
+// (D2 on the Uno/Nano), or 1 for INT1 (D3 on the Uno/Nano). External interrupts have a vector to
+// themselves and respond a little faster. Change the sense to LIRR_FALLING_EDGE to only be
+// interrupted by falling edges, which halves the number of interrupts for pulse distance protocols
+// (but doesn't work with pulse width or bi-phase protocols, or with learning mode).
+//#define lirrExternalInterrupt 0
+#define LIRR_ANY_EDGE 1
+#define LIRR_FALLING_EDGE 2
+#ifndef lirrExternalInterruptSense
+#define lirrExternalInterruptSense LIRR_ANY_EDGE
+#endif
+
+// Uncomment to leave the sensor's interrupt to your own code, for example to share the pin change
+// vector with SoftwareSerial or an encoder driver. lirr then doesn't define an ISR or set up an
+// interrupt, and your ISR passes each edge on with lirrFeedEdge() (see "Feeding edges from your own
+// interrupt" in the API documentation). Can't be used with lirrInputCapture, lirrExternalInterrupt,
+// lirrGateTime, lirrProfile or receivers.
+//#define lirrExternalFeed
+
+// Uncomment to turn the sensor's interrupt off for this many milliseconds after each complete
+// frame (including repeat frames), so that trailing edges, noise and bursts that can't be decoded
+// don't interrupt the main loop. Timer0's compare B interrupt (TIMER0_COMPB_vect, which the Arduino
+// core doesn't use) counts down the gap and turns the sensor's interrupt back on, and buttons are
+// still held and released as usual. It must be shorter than the shortest gap between the end of one
+// frame and the start of the next of the protocols in use (eg, 30 for NEC, 15 for SIRC, 80 for RC5),
+// or frames are missed. Only for the pin change interrupt and lirrExternalInterrupt, with the edges
+// decoded in the ISR (not with lirrInputCapture, lirrEdgeBufferSize or receivers).
+//#define lirrGateTime 30
+
+// Uncomment to queue decoded frames instead of only accepting a new code when no button is active.
+// Codes that arrive while the main loop is busy are then kept until lirrGetEvents() catches up.
+// The queue size must be a power of two, and each queued frame uses 10 bytes of RAM (8 with lirrTimerTicks).
+//#define lirrQueueSize 4
+
+// Uncomment to only record the time of each edge in the ISR, and to run the decoding functions
+// later from lirrGetEvents() or lirrProcess(). This keeps the ISR as short as possible, but it
+// still calls micros() unless lirrTimerTicks is defined too (the ISR then only reads Timer1 and
+// works out a 16 bit difference).
+// The buffer must hold all of the edges received between calls (a NEC frame has 68 edges, so 64
+// is only enough if lirrProcess() is called at least once during each frame).
+// The buffer size must be a power of two, and each buffered edge uses 2 bytes of RAM.
+//#define lirrEdgeBufferSize 128
+
+// Uncomment to decode pulse distance/width protocols with more than 32 bits, such as
+// PROTOCOL_KASEIKYO or the long frames of air conditioner remotes. Set it to the number of bytes
+// in the longest frame (5 to 32, so up to 256 bits). The bits of these frames are stored in a byte
+// array that lirrGetWideCode() copies out, and their buttonCode is a 32 bit hash of all of the bits.
+// Protocols with up to 32 bits are decoded in the same way as without this option.
+// Uses twice this many bytes of RAM, plus 1.
+//#define lirrWideCodes 16
+
+// The number of durations that capture mode (see lirrBeginCapture) can buffer until lirrCapture()
+// sends them. It must be a power of two, and each duration uses 2 bytes of RAM (only if capture
+// mode is used). At 115200 baud, 64 is enough for any protocol.
+#ifndef lirrCaptureBufferSize
+#define lirrCaptureBufferSize 64
+#endif
+
+// Uncomment and set to a protocol constant to build the library for that one protocol.
+// The ISR then calls the decoding function directly instead of through a function pointer,
+// and the protocol's timing values are compiled in as constants, which makes the ISR faster and
+// saves some RAM. Call lirrBegin() with only the pin number when this is defined.
+//#define lirrStaticProtocol PROTOCOL_NEC
 
 // ----------------------------------------------------------------------------------------------------
 // This library supports the three most common encoding types:
@@ -70,63 +162,136 @@ Limitations:
 // Please read it before making contributions.
 //
 // Before making changes, compile a test sketch that uses this library and note the compiled size
-// and use of dynamic memory. Do the same after making changes. Also uncomment #define lirrTest
-// in order to benchmark the ISR before & after making changes.
+// and use of dynamic memory. Do the same after making changes. Also uncomment #define lirrProfile
+// in order to benchmark the ISR before & after making changes (the worst case matters most).
+// The decoders can also be checked and benchmarked on a PC with extras/hostBench.
 // ----------------------------------------------------------------------------------------------------
 
+// edge times are timer ticks with lirrTimerTicks, otherwise microseconds from micros()
+// LIRR_US() converts a constant number of microseconds to the same units at compile time
+#ifdef lirrTimerTicks
+typedef uint16_t lirrTime_t;
+#define LIRR_US(us) ((us) * (F_CPU / 1000UL) / 64000UL)
+#else
+typedef uint32_t lirrTime_t;
+#define LIRR_US(us) (us)
+#endif
+
 // keep the settings structs POD (no constructors or destructors) to allow for proper optimization
 // use composition instead of inheritance. Inheritance precludes brace initialization and POD.
 
+// format options of the pulse fraction protocols (combine them with |)
+const uint8_t LIRR_LSB_FIRST = 1; // the first bit received is the least significant bit of the code (otherwise the most significant)
+const uint8_t LIRR_CHECK_INVERTED = 2; // reject frames unless the last 8 bits are the inverse of the 8 before them, and leave the last 8 out of the code
+const uint8_t LIRR_COMMAND_FIRST = 4; // the command is received before the address (see commandBits)
+
+// all of the timing values are in microseconds, wrapped in LIRR_US()
 struct lirrPulseFractionSettings_t
 {
-	// 12 bytes
-	const uint8_t bits; // the number of bits in a message
+	// 24 bytes (22 with lirrTimerTicks)
+	const uint8_t bits; // the number of bits in a message (more than 32 needs lirrWideCodes, and then only LIRR_LSB_FIRST of the format options applies)
 	const bool distanceMode; // true for pulse distace encoding, false for pulse width encoding
 	const uint16_t startMin; // distance/width of a start/AGC burst (microseconds), minus some amount of tolerance
 	const uint16_t startMax; // distance/width of a start/AGC burst (microseconds), plus some amount of tolerance
 	const uint16_t bitMin; // distance/width of a logical 0 or 1 (whichever is shorter), minus some amount of tolerance
 	const uint16_t bitSep; // the mean of bitMin and bitMax
 	const uint16_t bitMax; // distance/width of a logical 0 or 1 (whichever is longer), plus some amount of tolerance
+	const uint16_t repeatMin; // distance of a repeat frame's burst (pulse distance only), minus some tolerance, or 0 if there are no repeat frames
+	const uint16_t repeatMax; // distance of a repeat frame's burst, plus some tolerance
+	const lirrTime_t releaseTime; // a button is released once no frame or repeat frame with its code arrives for this long (0 to wait for repeatInt after any signal)
+	const uint16_t glitchTime; // marks shorter than this are ignored as noise (0 to keep all of them); keep it well under the shortest mark
+	const uint8_t format; // any of the LIRR_LSB_FIRST, LIRR_CHECK_INVERTED and LIRR_COMMAND_FIRST options above (0 for none)
+	const uint8_t commandBits; // the number of bits in the command, to report the code as (address << 16) | command (0 to report the bits as they are)
 };
 
+// all of the timing values are in microseconds, wrapped in LIRR_US()
 struct lirrBiPhaseSettings_t
 {
-	// 15 bytes
+	// 19 bytes (17 with lirrTimerTicks)
 	const uint8_t bits; // the number of bits in a message (do not include the first start pulse)
 	const bool aceRising; // true if a rising edge in the middle of a bit indicates a logical 1
 	const uint16_t bitTime[2]; // min & max microseconds between the middle of two adjacent command/address bits
 	const uint16_t startTime[2]; // min & max microseconds between the first rising edge and the middle of the first bit
 	const uint16_t toggleTime[2]; // min & max microseconds between the middle of the toggle bit and the adjacent command/address bits
 	const uint8_t togglePos; // the position of the toggle bit (the last bit received is == 0, and the first bit received == (bits-1))
+	const lirrTime_t releaseTime; // a button is released once no frame with its code and toggle bit arrives for this long (0 to wait for repeatInt after any signal)
 };
 
+// The release times are a little longer than the time from the end of one frame to the end of the next
+// while a button is held. NEC sends repeat frames (a 9ms burst and a 2.25ms space) instead of the code.
+// Protocols without a release time are held for as long as any edges arrive within repeatInt.
+// The glitch times drop the short pulses that fluorescent and LED lighting cause in most sensors.
+
 // For testing NEC, can use Apple TV remote or Kenwood RC-P400
-const lirrPulseFractionSettings_t PROTOCOL_NEC = {32,true,13300,13700,925,1687,2450}; // passed 22/11/15
+constexpr lirrPulseFractionSettings_t PROTOCOL_NEC = {32,true,LIRR_US(13300),LIRR_US(13700),LIRR_US(925),LIRR_US(1687),LIRR_US(2450),LIRR_US(11050),LIRR_US(11450),LIRR_US(115000),LIRR_US(200),0,0}; // passed 22/11/15
 
 // For testing JVC, set universal remote for JVC EM55FTR
-const lirrPulseFractionSettings_t PROTOCOL_JVC = {16,true,12424,12824,852,1578,2304};
+constexpr lirrPulseFractionSettings_t PROTOCOL_JVC = {16,true,LIRR_US(12424),LIRR_US(12824),LIRR_US(852),LIRR_US(1578),LIRR_US(2304),0,0,0,LIRR_US(200),0,0};
 
-const lirrPulseFractionSettings_t PROTOCOL_RCA = {24,true,7800,8200,1300,2000,2700};
+constexpr lirrPulseFractionSettings_t PROTOCOL_RCA = {24,true,LIRR_US(7800),LIRR_US(8200),LIRR_US(1300),LIRR_US(2000),LIRR_US(2700),0,0,0,LIRR_US(200),0,0};
 
 // For testing Sharp, set universal remote for Sharp VC-H813U VCR
-const lirrPulseFractionSettings_t PROTOCOL_SHARP = {15,true,0,0,800,1500,2200}; // passed 22/11/15
+constexpr lirrPulseFractionSettings_t PROTOCOL_SHARP = {15,true,LIRR_US(0),LIRR_US(0),LIRR_US(800),LIRR_US(1500),LIRR_US(2200),0,0,0,LIRR_US(150),0,0}; // passed 22/11/15
 
 // For testing Samsung, can use AA59-00666A Remote for Samsung UN39EH5003F LCD TV
-const lirrPulseFractionSettings_t PROTOCOL_SAMSUNG = {32,true,8760,9160,920,1680,2440}; // passed 22/11/15
+constexpr lirrPulseFractionSettings_t PROTOCOL_SAMSUNG = {32,true,LIRR_US(8760),LIRR_US(9160),LIRR_US(920),LIRR_US(1680),LIRR_US(2440),0,0,LIRR_US(115000),LIRR_US(200),0,0}; // passed 22/11/15
 
 // For testing SIRC, set universal remote for Sony Bravia KDL-55HX850 TV
-const lirrPulseFractionSettings_t PROTOCOL_SIRC = {12,false,2200,2600,400,900,1400}; // passed 22/11/15
+constexpr lirrPulseFractionSettings_t PROTOCOL_SIRC = {12,false,LIRR_US(2200),LIRR_US(2600),LIRR_US(400),LIRR_US(900),LIRR_US(1400),0,0,LIRR_US(60000),LIRR_US(200),0,0}; // passed 22/11/15
+
+// The _STD versions decode the same frames as above, but report the address and command in the same way as
+// the protocol specifications: (address << 16) | command, with the bits of each in the official order.
+// NEC and Samsung frames are rejected unless the command is followed by its inverse.
+constexpr lirrPulseFractionSettings_t PROTOCOL_NEC_STD = {32,true,LIRR_US(13300),LIRR_US(13700),LIRR_US(925),LIRR_US(1687),LIRR_US(2450),LIRR_US(11050),LIRR_US(11450),LIRR_US(115000),LIRR_US(200),LIRR_LSB_FIRST | LIRR_CHECK_INVERTED,8}; // 16 bit address (8 bits and their inverse, unless extended)
+constexpr lirrPulseFractionSettings_t PROTOCOL_JVC_STD = {16,true,LIRR_US(12424),LIRR_US(12824),LIRR_US(852),LIRR_US(1578),LIRR_US(2304),0,0,0,LIRR_US(200),LIRR_LSB_FIRST,8};
+constexpr lirrPulseFractionSettings_t PROTOCOL_SAMSUNG_STD = {32,true,LIRR_US(8760),LIRR_US(9160),LIRR_US(920),LIRR_US(1680),LIRR_US(2440),0,0,LIRR_US(115000),LIRR_US(200),LIRR_LSB_FIRST | LIRR_CHECK_INVERTED,8}; // 16 bit address (the same 8 bits twice)
+constexpr lirrPulseFractionSettings_t PROTOCOL_SIRC_STD = {12,false,LIRR_US(2200),LIRR_US(2600),LIRR_US(400),LIRR_US(900),LIRR_US(1400),0,0,LIRR_US(60000),LIRR_US(200),LIRR_LSB_FIRST | LIRR_COMMAND_FIRST,7}; // 5 bit address
+
+// Sony SIRC with 15 and 20 bits, which are sent in the same way as the 12 bit version
+constexpr lirrPulseFractionSettings_t PROTOCOL_SIRC15 = {15,false,LIRR_US(2200),LIRR_US(2600),LIRR_US(400),LIRR_US(900),LIRR_US(1400),0,0,LIRR_US(60000),LIRR_US(200),0,0};
+constexpr lirrPulseFractionSettings_t PROTOCOL_SIRC20 = {20,false,LIRR_US(2200),LIRR_US(2600),LIRR_US(400),LIRR_US(900),LIRR_US(1400),0,0,LIRR_US(60000),LIRR_US(200),0,0};
+
+#ifdef lirrWideCodes
+// Panasonic and the other Kaseikyo protocols send 48 bits, LSB first: a 16 bit vendor ID (0x2002 for
+// Panasonic), then 24 bits of address and command, and an 8 bit parity (lirrGetWideCode() has the bytes)
+constexpr lirrPulseFractionSettings_t PROTOCOL_KASEIKYO = {48,true,LIRR_US(4984),LIRR_US(5384),LIRR_US(664),LIRR_US(1296),LIRR_US(1928),0,0,LIRR_US(135000),LIRR_US(200),LIRR_LSB_FIRST,0};
+#endif
 
 // For testing RC5, set universal remote for Balanced Audio Technology VK-31 Amp
 // will also capture extended RC5
-const lirrBiPhaseSettings_t PROTOCOL_RC5 = {13,true,{1578,1978},{1578,1978},{1578,1978},11}; // passed 22/11/15
+constexpr lirrBiPhaseSettings_t PROTOCOL_RC5 = {13,true,{LIRR_US(1578),LIRR_US(1978)},{LIRR_US(1578),LIRR_US(1978)},{LIRR_US(1578),LIRR_US(1978)},11,LIRR_US(122000)}; // passed 22/11/15
 
 // For testing RC6 mode 0, set universal remote for Philips 49PFL4909 TV
-const lirrBiPhaseSettings_t PROTOCOL_RC6_MODE0 = {21,false,{688,1088},{3796,4196},{1132,1532},16}; // passed 22/11/15
+constexpr lirrBiPhaseSettings_t PROTOCOL_RC6_MODE0 = {21,false,{LIRR_US(688),LIRR_US(1088)},{LIRR_US(3796),LIRR_US(4196)},{LIRR_US(1132),LIRR_US(1532)},16,LIRR_US(115000)}; // passed 22/11/15
+
+// The built-in protocols are also in a table in flash (PROGMEM), and can be chosen at runtime by
+// these indexes instead (see lirrBegin and lirrSetProtocol). Only the protocols that are chosen are
+// copied into RAM, so a sketch that lets the user pick from many of them doesn't keep them all in RAM.
+const uint8_t LIRR_INDEX_NEC = 0;
+const uint8_t LIRR_INDEX_JVC = 1;
+const uint8_t LIRR_INDEX_RCA = 2;
+const uint8_t LIRR_INDEX_SHARP = 3;
+const uint8_t LIRR_INDEX_SAMSUNG = 4;
+const uint8_t LIRR_INDEX_SIRC = 5;
+const uint8_t LIRR_INDEX_NEC_STD = 6;
+const uint8_t LIRR_INDEX_JVC_STD = 7;
+const uint8_t LIRR_INDEX_SAMSUNG_STD = 8;
+const uint8_t LIRR_INDEX_SIRC_STD = 9;
+const uint8_t LIRR_INDEX_SIRC15 = 10;
+const uint8_t LIRR_INDEX_SIRC20 = 11;
+const uint8_t LIRR_INDEX_RC5 = 12;
+const uint8_t LIRR_INDEX_RC6_MODE0 = 13;
+#ifdef lirrWideCodes
+const uint8_t LIRR_INDEX_KASEIKYO = 14;
+const uint8_t lirrIndexCount = 15;
+#else
+const uint8_t lirrIndexCount = 14;
+#endif
 
 // global constants
 // 3 bytes
 const uint32_t repeatInt = 100000UL; // how long to wait for repeat codes before determining that a button is no longer being pressed
+const uint8_t lirrMaxProtocols = 8; // the most protocols that can be decoded at the same time (each uses 14 bytes of RAM, 10 with lirrTimerTicks)
 
 // not using a true enum here because this allows us to simulate a scoped enum with better Arduino IDE compatibility
 const uint8_t BUTTON_NONE = 0;
@@ -144,12 +309,277 @@ struct remoteEvents_t
 	volatile bool toggleState;
 };
 
+// see lirrOnEvent()
+typedef void (*lirrEventCallback_t)(const remoteEvents_t &remoteEvents);
+
+// one entry of a table that maps button codes to your own action numbers (see lirrGetAction())
+struct lirrAction_t
+{
+	// 5 bytes
+	uint32_t code; // a button code
+	uint8_t action; // the action number for it (anything but LIRR_NO_ACTION)
+};
+const uint8_t LIRR_NO_ACTION = 0;
+
+// gestures, worked out from the button events by lirrGetGesture()
+const uint8_t LIRR_GESTURE_NONE = 0;
+const uint8_t LIRR_GESTURE_PRESS = 1; // a button was pressed (once it's known not to be a double press, if doublePress is set)
+const uint8_t LIRR_GESTURE_DOUBLE_PRESS = 2; // the same button was pressed again soon after being released
+const uint8_t LIRR_GESTURE_LONG_PRESS = 3; // a button has been held for longPress
+const uint8_t LIRR_GESTURE_REPEAT = 4; // a button is still being held, sent at a rate that speeds up
+
+// all of the times are in milliseconds
+struct lirrGestureSettings_t
+{
+	// 11 bytes
+	const uint16_t longPress; // how long a button must be held for LIRR_GESTURE_LONG_PRESS (0 for none)
+	const uint16_t doublePress; // how soon after a release the next press is a double press (0 for none, and LIRR_GESTURE_PRESS is then sent right away)
+	const uint16_t repeatDelay; // how long a button must be held for the first LIRR_GESTURE_REPEAT (0 for none)
+	const uint16_t repeatFirst; // the time between the first repeats
+	const uint16_t repeatFastest; // the shortest time between repeats
+	const uint8_t repeatSpeedUp; // each time between repeats is this many 256ths shorter than the last (0 to keep the same rate)
+};
+
+// the state of lirrGetGesture(), one per sensor (set to {} before the first call)
+struct lirrGesture_t
+{
+	// 11 bytes
+	uint32_t buttonCode; // the button that the gesture is for
+	uint16_t pressTime; // the low 16 bits of millis() when the button was pressed
+	uint16_t eventTime; // ... when it was released (while waiting for a double press), or was last repeated
+	uint16_t repeatInterval; // the time until the next repeat
+	uint8_t state;
+};
+
+// the state of a decoding function, kept in a struct so that several decoders can run side by side
+// (for use by the library only)
+struct lirrDecoderState_t
+{
+	// 14 bytes (10 with lirrTimerTicks)
+	lirrTime_t referenceTime;
+	uint32_t incomingCode;
+	lirrTime_t markTime; // the start of the last mark (pulse fraction), or an edge that came too soon after the middle of a bit (bi-phase)
+	uint8_t bitsRemaining;
+	bool incomingToggle; // only used for bi-phase protocols
+};
+
+#ifdef lirrQueueSize
+struct lirrFrame_t
+{
+	// 10 bytes (8 with lirrTimerTicks)
+	uint32_t code; // the received code
+	lirrTime_t time; // when the frame was completed (microseconds, or timer ticks with lirrTimerTicks)
+	bool toggle; // the state of the toggle bit (bi-phase protocols only)
+	uint8_t protocol; // see lirrGetProtocol()
+};
+#endif
+
+#ifdef lirrProfile
+// histogram bin n counts the ISRs that took less than (lirrProfileBinCycles << n) cycles,
+// and the last bin also counts all of the ISRs that took longer
+const uint8_t lirrProfileBins = 8;
+const uint16_t lirrProfileBinCycles = 64;
+
+// index of decoderMaxCycles
+const uint8_t LIRR_PULSE_FRACTION = 0;
+const uint8_t LIRR_BI_PHASE = 1;
+
+struct lirrProfile_t
+{
+	// 26 bytes
+	// all counts saturate at 65535
+	uint16_t count; // the number of ISRs measured
+	uint16_t minCycles; // the shortest ISR
+	uint16_t maxCycles; // the longest ISR
+	uint16_t histogram[lirrProfileBins];
+	uint16_t decoderMaxCycles[2]; // the longest run of each type of decoding function
+};
+#endif
+
+#ifdef lirrStats
+struct lirrStats_t
+{
+	// 16 bytes
+	// all counts saturate at 65535, and each decoder counts its own starts and rejections
+	uint16_t edges; // edges received by the ISR
+	uint16_t starts; // start bursts accepted (with bi-phase, rising edges that could start a frame)
+	uint16_t frames; // complete frames, including the ones that are sent again while a button is held
+	uint16_t busy; // complete frames that were dropped because another button was active (or the queue was full)
+	uint16_t badBits; // pulse distance/width frames abandoned because a bit was out of its window
+	uint16_t badStarts; // marks or spaces too long for a bit, that weren't a start burst or repeat frame (but no more than twice as long as a start burst)
+	uint16_t badBiPhase; // bi-phase frames abandoned because an edge was out of its window
+	uint16_t badChecks; // frames rejected by LIRR_CHECK_INVERTED
+};
+#endif
+
+// several sensors can share the pin change interrupt, each with its own protocol and events,
+// as long as the protocol isn't chosen at compile time and edges are decoded in the ISR
+#if !defined(lirrStaticProtocol) && !defined(lirrInputCapture) && !defined(lirrExternalInterrupt) && !defined(lirrEdgeBufferSize) && !defined(lirrGateTime) && !defined(lirrExternalFeed)
+#define LIRR_RECEIVERS_SUPPORTED
+#endif
+
+// learning mode measures every mark and space, so it needs both edges, and the protocol can't be
+// chosen at compile time
+#if !defined(lirrStaticProtocol) && !(defined(lirrExternalInterrupt) && (lirrExternalInterruptSense == LIRR_FALLING_EDGE))
+#define LIRR_LEARNING_SUPPORTED
+#endif
+
+#ifdef LIRR_RECEIVERS_SUPPORTED
+struct lirrReceiver_t
+{
+	// 40 bytes
+	// for use by the library only
+	lirrReceiver_t *pNext;
+	void (*pDecodeFunction)(lirrReceiver_t &receiver, bool pinState, lirrTime_t curTime);
+	const void *pSettings;
+	uint8_t pinMask;
+	lirrDecoderState_t decoder;
+	remoteEvents_t remoteEvents;
+	lirrTime_t frameTime; // when the last frame or repeat frame of the active code arrived
+	lirrTime_t releaseTime; // the releaseTime of the receiver's protocol
+	bool activeToggle; // the toggle bit of the active code
+};
+#endif
+
+#ifdef LIRR_LEARNING_SUPPORTED
+// what learning mode has found out about a remote's frames (see lirrBeginLearning())
+// it's plain data, so it can be kept in EEPROM (with EEPROM.put() and EEPROM.get())
+const uint8_t LIRR_LEARN_NONE = 0;
+const uint8_t LIRR_LEARN_DISTANCE = 1; // pulse distance (lirrPulseFractionSettings_t)
+const uint8_t LIRR_LEARN_WIDTH = 2; // pulse width (lirrPulseFractionSettings_t)
+const uint8_t LIRR_LEARN_BI_PHASE = 3; // bi-phase (lirrBiPhaseSettings_t)
+
+struct lirrLearned_t
+{
+	// 25 bytes
+	uint8_t encoding; // one of the above
+	uint8_t frames; // the number of frames learned from
+	uint8_t bits; // the number of bits in a frame
+	uint32_t code; // the last frame, decoded with the learned settings (toggle bit included)
+	uint32_t codeChanges; // the bits that changed from one frame to the next
+	uint16_t start[2]; // the shortest and longest start burst (0 if there isn't one, and always for bi-phase), in microseconds
+	uint16_t bitShort[2]; // the shortest and longest logical 0 (pulse fraction), or time between the middles of two bits (bi-phase)
+	uint16_t bitLong[2]; // the same for a logical 1 (pulse fraction only)
+	uint16_t shortestMark; // pulse fraction only
+};
+#endif
+
+#ifdef lirrStaticProtocol
+// the protocol is chosen at compile time
+void lirrBegin(uint8_t pinInterrupt);
+#else
 // using overloaded functions here is important for allowing unused decoding routines
 // to be optimized out while retaining a common API
 void lirrBegin(uint8_t pinInterrupt, const lirrPulseFractionSettings_t &remoteProtocol);
 void lirrBegin(uint8_t pinInterrupt, const lirrBiPhaseSettings_t &remoteProtocol);
 
+// decodes several protocols at the same time, and lirrGetProtocol() tells you which one was received
+// protocols are numbered in order, starting with pfProtocols[0], followed by bpProtocols[0]
+// protocols with more than 32 bits (PROTOCOL_KASEIKYO) can't be decoded this way, and none of their frames are received
+void lirrBegin(uint8_t pinInterrupt,
+	const lirrPulseFractionSettings_t *const pfProtocols[], uint8_t pfCount,
+	const lirrBiPhaseSettings_t *const bpProtocols[], uint8_t bpCount);
+
+// switch to another protocol (or protocols) after lirrBegin(), without setting up the pin and interrupt again
+// any frame that was part way through is dropped, and the events are cleared
+void lirrSetProtocol(const lirrPulseFractionSettings_t &remoteProtocol);
+void lirrSetProtocol(const lirrBiPhaseSettings_t &remoteProtocol);
+void lirrSetProtocol(const lirrPulseFractionSettings_t *const pfProtocols[], uint8_t pfCount,
+	const lirrBiPhaseSettings_t *const bpProtocols[], uint8_t bpCount);
+
+// the same, choosing the protocols from the table in flash by their LIRR_INDEX_ constants
+// the chosen protocols are copied into RAM (up to lirrMaxProtocols); with several, they're numbered
+// with the pulse distance/width protocols first
+// returns false if an index isn't in the table: a single one changes nothing (lirrBegin() doesn't set
+// up the sensor), and in a list it's left out, as are protocols with more than 32 bits and any past
+// lirrMaxProtocols
+bool lirrBegin(uint8_t pinInterrupt, uint8_t protocolIndex);
+bool lirrBegin(uint8_t pinInterrupt, const uint8_t protocolIndexes[], uint8_t count);
+bool lirrSetProtocol(uint8_t protocolIndex);
+bool lirrSetProtocol(const uint8_t protocolIndexes[], uint8_t count);
+#endif
+uint8_t lirrGetProtocol(void);
+
+// stops receiving by disabling the interrupt set up by lirrBegin() (call lirrBegin() to start again)
+// not for use with receivers
+void lirrEnd(void);
+
+#ifdef lirrWideCodes
+// copies the bits of the current button's frame into code (which must hold lirrWideCodes bytes),
+// 8 bits per byte in the order they were received, and returns the number of bits (0 if no frame
+// with more than 32 bits has been received yet)
+uint8_t lirrGetWideCode(uint8_t code[lirrWideCodes]);
+#endif
+
+#ifdef lirrProfile
+// ISR cycle counts don't include the ISR's prologue and epilogue (see the disassembly for those)
+lirrProfile_t lirrGetProfile(void);
+void lirrClearProfile(void);
+#endif
+
+#ifdef lirrStats
+lirrStats_t lirrGetStats(void);
+void lirrClearStats(void);
+#endif
+
 void lirrClearEvents(void);
 remoteEvents_t lirrGetEvents(void);
 
+// instead of calling lirrGetEvents(), call lirrService() from loop() and the callback is called
+// with the events once each time the button is pressed, starts being held, and is released
+void lirrOnEvent(lirrEventCallback_t pCallback);
+void lirrService(void);
+
+// looks up the action for a button code in a table that is in flash (PROGMEM) and sorted by code
+// returns LIRR_NO_ACTION if the code isn't in the table (extras/makeActionTable.py writes the table)
+uint8_t lirrGetAction(uint32_t buttonCode, const lirrAction_t *pActions, uint8_t actionCount);
+remoteEvents_t lirrGetEvents(uint8_t &action, const lirrAction_t *pActions, uint8_t actionCount);
+
+// works out long presses, double presses and auto-repeat from the events returned by lirrGetEvents()
+// pass it the events each time around loop(); returns a LIRR_GESTURE_ constant, for gesture.buttonCode
+uint8_t lirrGetGesture(lirrGesture_t &gesture, const remoteEvents_t &remoteEvents, const lirrGestureSettings_t &settings);
+
+#ifdef LIRR_RECEIVERS_SUPPORTED
+// one receiver per sensor; all of the sensors must be on pins that belong to lirrPinChangeVector
+// protocols with more than 32 bits can't be used with a receiver (none of their frames are received)
+void lirrBegin(lirrReceiver_t &receiver, uint8_t pinInterrupt, const lirrPulseFractionSettings_t &remoteProtocol);
+void lirrBegin(lirrReceiver_t &receiver, uint8_t pinInterrupt, const lirrBiPhaseSettings_t &remoteProtocol);
+void lirrClearEvents(lirrReceiver_t &receiver);
+remoteEvents_t lirrGetEvents(lirrReceiver_t &receiver);
+#endif
+#ifdef lirrQueueSize
+bool lirrReadFrame(lirrFrame_t &frame);
+#endif
+#ifdef lirrEdgeBufferSize
+void lirrProcess(void);
+#endif
+#ifdef lirrExternalFeed
+// call from your ISR, with interrupts disabled, for each edge of the sensor's pin: pinState is true
+// while IR is detected (the pin is low), and edgeTime is micros(), or the Timer1 count with
+// lirrTimerTicks; calls with the same pinState as the last one are ignored
+void lirrFeedEdge(bool pinState, lirrTime_t edgeTime);
+#endif
+
+// sleeps until the next interrupt, as deeply as the signal being received allows
+void lirrSleep(void);
+
+#ifdef LIRR_LEARNING_SUPPORTED
+// learning mode: instead of decoding, records the frames of an unknown remote and works out their
+// encoding and timing, so that settings can be made for it (see the learnRemote example)
+// lirrLearn() returns true each time another frame has been learned
+// not available with lirrExternalInterruptSense == LIRR_FALLING_EDGE, since it measures the marks
+void lirrBeginLearning(uint8_t pinInterrupt, lirrLearned_t &learned);
+bool lirrLearn(lirrLearned_t &learned);
+lirrPulseFractionSettings_t lirrLearnedPulseFraction(const lirrLearned_t &learned); // if learned.encoding isn't LIRR_LEARN_BI_PHASE
+lirrBiPhaseSettings_t lirrLearnedBiPhase(const lirrLearned_t &learned); // if it is
+#endif
+
+#ifndef lirrStaticProtocol
+// capture mode: instead of decoding, sends the duration of every mark and space to out
+// (usually Serial) in checksummed binary packets, which extras/captureToTrace.py turns into traces
+// call lirrCapture() as often as possible from loop()
+void lirrBeginCapture(uint8_t pinInterrupt);
+void lirrCapture(Print &out);
+#endif
+
 #endif